@@ -0,0 +1,7 @@
+#!/bin/bash
+BIN=conditional
+SRC=$BIN.c
+
+cc -w -o $BIN $SRC >& /dev/null || exit 1
+[[ "$(timeout 1 ./$BIN)" == "$(printf '23\n23\n23')" ]] || exit 1
+rm -f $BIN
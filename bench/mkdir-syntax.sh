@@ -0,0 +1,6 @@
+#!/bin/bash
+# a cheap oracle, so that chisel's own overhead dominates
+SRC=mkdir-syntax.c
+
+cc -w -fsyntax-only $SRC >& /dev/null || exit 1
+grep -q "umask" $SRC || exit 1
@@ -0,0 +1,17 @@
+#!/bin/bash
+BIN=mkdir
+SRC=$BIN.c
+
+function fail {
+  rm -rf $BIN d1 d2
+  exit 1
+}
+
+rm -rf d1 d2
+cc -w -o $BIN $SRC >& /dev/null || fail
+{ timeout 1 ./$BIN d1 && [[ -d d1 ]] ; } >& /dev/null || fail
+timeout 1 ./$BIN d1 >& /dev/null && fail
+{ timeout 1 ./$BIN -p d2/a/b && [[ -d d2/a/b ]] ; } >& /dev/null || fail
+timeout 1 ./$BIN -m 700 d2/c >& /dev/null || fail
+[[ "$(stat -c %a d2/c)" == "700" ]] || fail
+rm -rf $BIN d1 d2
@@ -0,0 +1,7 @@
+#!/bin/bash
+BIN=simple
+SRC=$BIN.c
+
+cc -w -o $BIN $SRC >& /dev/null || exit 1
+[[ "$(timeout 1 ./$BIN)" == "$(printf 'hi!\nhi!')" ]] || exit 1
+rm -f $BIN
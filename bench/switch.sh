@@ -0,0 +1,7 @@
+#!/bin/bash
+BIN=switch
+SRC=$BIN.c
+
+cc -w -o $BIN $SRC >& /dev/null || exit 1
+[[ "$(timeout 1 ./$BIN -n -v -n)" == "2" ]] || exit 1
+rm -f $BIN
@@ -0,0 +1,26 @@
+#include <stdio.h>
+
+int verbose = 0;
+int count = 0;
+
+int main(int argc, char **argv)
+{
+  int i;
+  for (i = 1; i < argc; i++) {
+    switch (argv[i][1]) {
+    case 'v':
+      verbose = 1;
+      break;
+    case 'n':
+      count++;
+      break;
+    case 'h':
+      puts("usage: switch [-v] [-n]...");
+      break;
+    default:
+      count--;
+    }
+  }
+  printf("%d\n", count);
+  return 0;
+}
@@ -0,0 +1,16 @@
+#ifndef INCLUDE_BUDGET_H_
+#define INCLUDE_BUDGET_H_
+
+// Wall-clock budget of an anytime run (--time_budget).
+class Budget {
+public:
+  static void start(int seconds);
+  static bool isLimited();
+  static bool expired();
+
+private:
+  static bool limited;
+  static long long deadline; // steady_clock nanoseconds
+};
+
+#endif // INCLUDE_BUDGET_H_
@@ -5,6 +5,7 @@ class Counter {
 public:
   Counter();
   void increment();
+  void add(unsigned int n);
   unsigned int count();
 
 private:
@@ -0,0 +1,23 @@
+#ifndef INCLUDE_COVERAGE_H_
+#define INCLUDE_COVERAGE_H_
+
+#include <map>
+#include <string>
+
+// Line coverage of the input program, obtained by running the oracle once
+// with COV=1 in a sandbox and reading the gcov output there; the coverage
+// files of the working directory are left alone.
+class Coverage {
+public:
+  static bool collect(const std::string &srcPath);
+  static bool isExecutable(unsigned line);
+  static bool isExecuted(unsigned line);
+
+private:
+  // execution count of every executable line; 0 for lines gcov marks as
+  // never executed
+  static std::map<unsigned, long> lineCounts;
+  static bool load(const std::string &gcovPath);
+};
+
+#endif // INCLUDE_COVERAGE_H_
@@ -0,0 +1,42 @@
+#ifndef COVERAGE_REDUCTION_H
+#define COVERAGE_REDUCTION_H
+
+#include "Transformation.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+class DeclGroupRef;
+class ASTContext;
+class Stmt;
+} // namespace clang
+
+class CoverageReductionCollectionVisitor;
+
+class CoverageReduction : public Transformation {
+  friend class CoverageReductionCollectionVisitor;
+
+public:
+  CoverageReduction(const char *TransName, const char *Desc)
+      : Transformation(TransName, Desc), CollectionVisitor(NULL) {}
+
+  ~CoverageReduction(void);
+
+private:
+  virtual void Initialize(clang::ASTContext &context);
+  virtual bool HandleTopLevelDecl(clang::DeclGroupRef D);
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+  void coverageReduction(void);
+  bool isUnexecuted(clang::SourceRange range);
+  void collectStatements(clang::Stmt *S, std::vector<clang::SourceRange> &v);
+  bool test(std::vector<clang::SourceRange> &toBeRemoved);
+  void ddmin(std::vector<clang::SourceRange> ranges);
+  CoverageReductionCollectionVisitor *CollectionVisitor;
+
+  CoverageReduction(void);
+  CoverageReduction(const CoverageReduction &);
+  void operator=(const CoverageReduction &);
+
+  std::vector<clang::FunctionDecl *> functions;
+};
+#endif
@@ -0,0 +1,37 @@
+#ifndef INCLUDE_DELIMITER_INDEX_H_
+#define INCLUDE_DELIMITER_INDEX_H_
+
+#include <vector>
+
+// Sorted offsets of ';', '{', '}' and ')' in a buffer, leaving out those in
+// comments and string or character literals. Built once per buffer, then every
+// query is a binary search.
+class DelimiterIndex {
+public:
+  static bool isIndexed(char Symbol);
+
+  void build(const char *BufBegin, const char *BufEnd);
+
+  void clear(void);
+
+  bool isBuilt(void) const { return Begin != nullptr; }
+
+  bool contains(const char *Buf) const { return Buf >= Begin && Buf < End; }
+
+  // offset from Buf to the first Symbol at or after it, or -1
+  int findNext(const char *Buf, char Symbol) const;
+
+  // offset (<= 0) from Buf to the last Symbol at or before it, or 1
+  int findPrevious(const char *Buf, char Symbol) const;
+
+private:
+  static int getSlot(char Symbol);
+
+  const char *Begin = nullptr;
+
+  const char *End = nullptr;
+
+  std::vector<unsigned> Positions[4];
+};
+
+#endif // INCLUDE_DELIMITER_INDEX_H_
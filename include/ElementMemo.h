@@ -0,0 +1,42 @@
+#ifndef INCLUDE_ELEMENT_MEMO_H_
+#define INCLUDE_ELEMENT_MEMO_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Remembers elements whose single removal was rejected by the oracle, keyed
+// by a fingerprint that survives re-parsing, so that later fixpoint
+// iterations do not test them again (--memo). An entry goes stale when a
+// removal touches one of its identifiers; dependencies through macros, types
+// or tags can be missed, so the memo may keep removable elements and is off
+// by default.
+class ElementMemo {
+public:
+  // offset is the byte offset of the element within its function, which
+  // blanking preserves; it tells identical statements such as two `break;`
+  // apart
+  static std::string fingerprint(const std::string &kind,
+                                 const std::string &function,
+                                 unsigned offset, const std::string &text);
+  // counts a memo hit and forgets a stale entry
+  static bool isEssential(const std::string &fp);
+  // the same answer, without touching the memo or the counters
+  static bool isKnownEssential(const std::string &fp);
+  static void markEssential(const std::string &fp, const std::string &text);
+  static void markRemoved(const std::string &text);
+  static void clear(void);
+
+private:
+  struct Entry {
+    unsigned long epoch;
+    std::vector<std::string> deps;
+  };
+  static std::map<std::string, Entry> essentials;
+  static std::map<std::string, unsigned long> lastRemoved;
+  static unsigned long epoch;
+  static std::vector<std::string> getIdentifiers(const std::string &text);
+  static bool isStale(const Entry &entry);
+};
+
+#endif // INCLUDE_ELEMENT_MEMO_H_
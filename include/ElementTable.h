@@ -0,0 +1,36 @@
+#ifndef INCLUDE_ELEMENT_TABLE_H_
+#define INCLUDE_ELEMENT_TABLE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// The reduction candidates of one parse, one column per attribute. Ranges are
+// computed once when an element is added; a candidate is a set of element
+// ids and removing it only needs the union of their byte ranges.
+class ElementTable {
+public:
+  // [begin, end) byte offsets in the main file
+  typedef std::pair<unsigned, unsigned> Range;
+
+  unsigned add(const std::string &Kind, unsigned Begin, unsigned End,
+               int Parent = -1, unsigned Deps = 0);
+
+  void clear(void);
+
+  unsigned size(void) const { return Begins.size(); }
+
+  Range getRange(unsigned Id) const { return Range(Begins[Id], Ends[Id]); }
+
+  // sorted, with overlapping and adjacent ranges merged
+  std::vector<Range> getRanges(const std::vector<unsigned> &Ids) const;
+
+  std::vector<std::string> Kinds;
+  std::vector<unsigned> Begins;
+  std::vector<unsigned> Ends;
+  std::vector<unsigned> Sizes;
+  std::vector<int> Parents;
+  std::vector<unsigned> Dependencies;
+};
+
+#endif // INCLUDE_ELEMENT_TABLE_H_
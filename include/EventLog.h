@@ -0,0 +1,40 @@
+#ifndef INCLUDE_EVENT_LOG_H_
+#define INCLUDE_EVENT_LOG_H_
+
+#include <string>
+
+// One CSV record per oracle call (--event_log FILE). Records are buffered per
+// thread and appended with a single write(2) per flush to an O_APPEND file,
+// so neither threads nor forked workers take a lock.
+class EventLog {
+public:
+  struct Record {
+    std::string phase;
+    std::string kind;
+    std::string node; // hdd statement class, if any
+    unsigned long removed = 0; // bytes removed on top of the best version
+    unsigned long size = 0;    // bytes of the candidate
+    unsigned long long hash = 0;
+    bool verdict = false;
+    double wall = 0; // seconds
+    double cpu = 0;  // seconds spent by the oracle and its children
+    int exitCode = 0;
+  };
+
+  static bool open(const std::string &file);
+  static bool isOpen() { return fd >= 0; }
+  static void record(const Record &r);
+  // writes the buffer of the calling thread; also needed before fork and
+  // _exit, which would otherwise duplicate or drop it
+  static void flush();
+  static void close();
+
+  // user and system time of the reaped children so far
+  static double getChildrenCPUTime();
+  static int getExitCode(int status);
+
+private:
+  static int fd;
+};
+
+#endif // INCLUDE_EVENT_LOG_H_
@@ -1,11 +1,15 @@
 #ifndef GLOBAL_REDUCTION_H
 #define GLOBAL_REDUCTION_H
 
+#include "ElementTable.h"
 #include "Transformation.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include <string>
 
 namespace clang {
 class DeclGroupRef;
+class FunctionDecl;
 class ASTContext;
 class Stmt;
 } // namespace clang
@@ -21,22 +25,48 @@ public:
 
   ~GlobalReduction(void);
 
+  virtual bool skipFunctionBodies() { return true; }
+
 private:
   virtual void Initialize(clang::ASTContext &context);
   virtual bool HandleTopLevelDecl(clang::DeclGroupRef D);
   virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
   void globalReduction(void);
   void prettyPrintSubset(std::vector<clang::Decl *> vec);
-  void ddmin(std::vector<clang::Decl *> &decls);
-  bool test(std::vector<clang::Decl *> &toBeRemoved);
+  void ddmin(void);
+  bool test(std::vector<unsigned> &toBeRemoved,
+            std::vector<unsigned> *next = NULL);
+  bool isKnownEssential(std::vector<unsigned> &subset);
+  void buildElementTable(void);
+  void addDecl(clang::Decl *D);
+  clang::SourceRange getRemovalRange(unsigned id);
+  std::string getFingerprint(unsigned id, const std::string &text);
+  void scanSkippedBody(clang::FunctionDecl *FD,
+                       llvm::StringMap<std::vector<unsigned>> &globals);
   GlobalReductionCollectionVisitor *CollectionVisitor;
-  std::vector<std::vector<clang::Decl *>>
-  refineSubsets(std::vector<std::vector<clang::Decl *>> &subsets);
+  std::vector<std::vector<unsigned>>
+  refineSubsets(std::vector<std::vector<unsigned>> &subsets);
   GlobalReduction(void);
   GlobalReduction(const GlobalReduction &);
   void operator=(const GlobalReduction &);
 
+  // Per-parse state, reset in Initialize. Decls are numbered in the order
+  // they are collected and the tables below are indexed by that number; the
+  // pointers are only valid while the ASTContext of this parse lives.
   std::vector<clang::Decl *> decls;
-  std::vector<clang::Stmt *> functionBodies;
+  llvm::DenseMap<const clang::Decl *, unsigned> DeclIds;
+  // DeclRefExprs naming decl i
+  std::vector<unsigned> References;
+  // bodies the parser skipped, where they end, and how often the globals are
+  // mentioned in them
+  std::vector<clang::FunctionDecl *> skippedBodies;
+  std::vector<clang::SourceLocation> BodyEnds;
+  std::vector<unsigned> LexicalRefs;
+  // the candidates of this parse; Elements[i] is the decl of Table row i
+  ElementTable Table;
+  std::vector<clang::Decl *> Elements;
+  // the candidate already written to the input file while the previous one
+  // was being tested
+  std::vector<unsigned> StagedElements;
 };
 #endif
@@ -0,0 +1,33 @@
+#ifndef LINE_REDUCTION_H
+#define LINE_REDUCTION_H
+
+#include <string>
+#include <vector>
+
+// Parser-free delta debugging over chunks of lines, run before any AST-based
+// pass to shrink huge inputs cheaply. Only chunks whose braces, brackets and
+// preprocessor conditionals are balanced are tried.
+class LineReduction {
+public:
+  static void reduce(const std::string &srcPath);
+
+private:
+  // nesting state at the start of a line
+  struct Boundary {
+    int brace;
+    int cond;
+    bool cut; // false inside a comment, a string or a continued line
+  };
+
+  static std::vector<Boundary> scan(const std::vector<std::string> &lines);
+  static bool isBalanced(const std::vector<Boundary> &boundaries, int begin,
+                         int end);
+  static bool isBlank(const std::vector<std::string> &lines, int begin,
+                      int end);
+  static bool test(const std::string &srcPath,
+                   const std::vector<std::string> &lines, int begin, int end);
+  static void write(const std::string &srcPath,
+                    const std::vector<std::string> &lines, int begin, int end);
+};
+
+#endif
@@ -1,8 +1,11 @@
 #ifndef LOCAL_REDUCTION_H
 #define LOCAL_REDUCTION_H
 
+#include "ElementTable.h"
 #include "Transformation.h"
+#include "llvm/ADT/DenseMap.h"
 #include <iterator>
+#include <map>
 #include <queue>
 #include <string>
 
@@ -19,7 +22,8 @@ class LocalReduction : public Transformation {
 
 public:
   LocalReduction(const char *TransName, const char *Desc)
-      : Transformation(TransName, Desc), CollectionVisitor(NULL) {}
+      : Transformation(TransName, Desc), CollectionVisitor(NULL),
+        CurrentFunction(0) {}
 
   ~LocalReduction(void);
 
@@ -28,23 +32,69 @@ private:
   virtual bool HandleTopLevelDecl(clang::DeclGroupRef D);
   virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
   void localReduction(void);
+  void reduceFunction(int i);
+  void push(clang::Stmt *s);
+  void drain(void);
+  double getPriority(clang::Stmt *s);
+  void parallelLocalReduction(void);
+  void reduceFunctionInSandbox(int i, const std::string &dir);
+  std::vector<Range> readEdits(const std::string &dir);
+  void mergeEdits(std::vector<std::vector<Range>> &edits,
+                  std::vector<int> functions);
   std::vector<clang::Stmt *> getImmediateChildren(clang::Stmt *s);
   std::vector<clang::Stmt *> getBodyStatements(clang::CompoundStmt *s);
   void hdd(clang::Stmt *s);
   void ddmin(std::vector<clang::Stmt *> stmts);
   bool test(std::vector<clang::Stmt *> &toBeRemoved);
+  bool testMemoized(std::vector<clang::Stmt *> &toBeRemoved);
+  int
+  testSpeculatively(std::vector<std::vector<clang::SourceRange>> &candidates,
+                    std::string msg);
+  int getElement(clang::Stmt *s);
+  bool getRange(clang::Stmt *first, clang::Stmt *last, Range &range);
+  std::string getElementText(clang::Stmt *first, clang::Stmt *last);
   LocalReductionCollectionVisitor *CollectionVisitor;
 
   void reduceIf(clang::IfStmt *IS);
   void reduceWhile(clang::WhileStmt *WS);
   void reduceCompound(clang::CompoundStmt *CS);
   void reduceLabel(clang::LabelStmt *LS);
+  void reduceFor(clang::ForStmt *FS);
+  void reduceDo(clang::DoStmt *DS);
+  void reduceSwitch(clang::SwitchStmt *SS);
+  void reduceCase(clang::SwitchCase *SC);
+  std::vector<std::vector<clang::Stmt *>>
+  ddminCases(std::vector<std::vector<clang::Stmt *>> cases);
 
   LocalReduction(void);
   LocalReduction(const LocalReduction &);
   void operator=(const LocalReduction &);
 
+  // per-parse state, reset in Initialize
   std::vector<clang::Stmt *> functionBodies;
-  std::queue<clang::Stmt *> q;
+  // statements are added to the table the first time they are looked at
+  ElementTable Table;
+  llvm::DenseMap<const clang::Stmt *, int> ElementIds;
+  std::vector<std::string> functionNames;
+  int CurrentFunction;
+  std::string CurrentFunctionName;
+
+  // A pending hdd node. Nodes are taken first in, first out, unless a time
+  // budget asks for the most expected bytes removed per oracle second first.
+  // Only the hdd nodes of local reduction are queued; global reduction keeps
+  // its ddmin order, whose subsets are split further as they fail.
+  struct Pending {
+    double priority;
+    unsigned long order;
+    clang::Stmt *stmt;
+    int function;
+    bool operator<(const Pending &other) const {
+      if (priority != other.priority)
+        return priority < other.priority;
+      return order > other.order;
+    }
+  };
+  std::priority_queue<Pending> q;
+  unsigned long pushed = 0;
 };
 #endif
@@ -0,0 +1,19 @@
+#ifndef INCLUDE_MEMORY_H_
+#define INCLUDE_MEMORY_H_
+
+// Resident memory of the process and its limit (--max_rss).
+class Memory {
+public:
+  static void setLimit(int megabytes);
+  static bool isLimited();
+  // returns freed heap pages to the system first
+  static bool exceeded();
+  // in bytes; 0 where unavailable
+  static long long getCurrentRSS();
+  static long long getPeakRSS();
+
+private:
+  static long long limit; // bytes, 0 if unlimited
+};
+
+#endif // INCLUDE_MEMORY_H_
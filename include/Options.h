@@ -10,15 +10,27 @@ public:
   static std::string oracleFile;
   static std::string outputDir;
   static bool saveTemp;
+  static int jobs;
+  static bool copySandbox;
+  static int timeBudget;
+  static int maxRSS;
   static bool decisionTree;
   static bool delayLearning;
   static bool skipGlobal;
   static bool skipLocal;
+  static bool tokenReduction;
+  static bool coverage;
+  static bool linePrepass;
   static bool noCache;
+  static bool memoize;
   static bool globalDep;
   static bool localDep;
   static bool skipDCE;
   static bool profile;
+  static std::string eventLog;
+  static std::string reportJson;
+  static std::string statusFile;
+  static std::string traceFile;
   static bool verbose;
   static bool stat;
 
@@ -0,0 +1,125 @@
+#ifndef INCLUDE_ORACLE_H_
+#define INCLUDE_ORACLE_H_
+
+#include <functional>
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Decides whether a candidate program is kept. The oracle of a run is either
+// an external command, the usual ORACLE script, or a synthetic predicate
+// checked in-process (ORACLE = builtin:SPEC), which takes the forks and the
+// shell out of the measurements of chisel's own overhead.
+class Oracle {
+public:
+  // exit code 1, in the form system() reports it
+  static const int Rejected = 1 << 8;
+
+  virtual ~Oracle() {}
+  // Returns 0 if the program is kept, or the status of the failing check in
+  // the form system() reports it.
+  virtual int check(const std::string &program) = 0;
+  // an external oracle ignores the text and runs on the input file
+  virtual bool isExternal() const { return false; }
+
+  static bool isBuiltin(const std::string &spec);
+  // Makes spec the oracle of this run; false, with a message, if it is not
+  // a valid builtin spec.
+  static bool setUp(const std::string &spec, std::string &error);
+  // makes oracle the oracle of this run, null going back to ORACLE, and
+  // returns the one it replaces
+  static std::unique_ptr<Oracle> use(std::unique_ptr<Oracle> oracle);
+  static Oracle *get();
+  // Runs the oracle of this run on the input file in the current directory.
+  static int run();
+
+  static std::unique_ptr<Oracle> create(const std::string &spec,
+                                        std::string &error);
+
+private:
+  static std::unique_ptr<Oracle> Instance;
+};
+
+// The ORACLE script, run through the shell.
+class ExternalOracle : public Oracle {
+public:
+  explicit ExternalOracle(const std::string &command) : Command(command) {}
+  int check(const std::string &program);
+  bool isExternal() const { return true; }
+
+private:
+  std::string Command;
+};
+
+// An in-process function; true keeps the program.
+class CallbackOracle : public Oracle {
+public:
+  explicit CallbackOracle(
+      const std::function<bool(const std::string &)> &callback)
+      : Callback(callback) {}
+  int check(const std::string &program) {
+    return Callback(program) ? 0 : Rejected;
+  }
+
+private:
+  std::function<bool(const std::string &)> Callback;
+};
+
+// builtin:parses; no more parse errors than the original program.
+class ParsesOracle : public Oracle {
+public:
+  explicit ParsesOracle(unsigned baseErrors) : BaseErrors(baseErrors) {}
+  int check(const std::string &program);
+
+private:
+  unsigned BaseErrors;
+};
+
+// builtin:symbols=A,B,...; every symbol still appears as a whole word.
+class SymbolsOracle : public Oracle {
+public:
+  explicit SymbolsOracle(const std::vector<std::string> &symbols)
+      : Symbols(symbols) {}
+  int check(const std::string &program);
+
+private:
+  std::vector<std::string> Symbols;
+};
+
+// builtin:pattern=REGEX; the program still matches REGEX (ECMAScript).
+class PatternOracle : public Oracle {
+public:
+  explicit PatternOracle(const std::regex &pattern) : Pattern(pattern) {}
+  int check(const std::string &program);
+
+private:
+  std::regex Pattern;
+};
+
+// builtin:random=P[,SEED]; keeps a fraction P of the candidates, picked by a
+// hash of their text so that the same candidate always gets the same verdict.
+class RandomOracle : public Oracle {
+public:
+  RandomOracle(double probability, unsigned long long seed)
+      : Probability(probability), Seed(seed) {}
+  int check(const std::string &program);
+
+private:
+  double Probability;
+  unsigned long long Seed;
+};
+
+// SPEC+SPEC+...; all of them hold.
+class AllOracle : public Oracle {
+public:
+  void add(std::unique_ptr<Oracle> oracle) {
+    Oracles.emplace_back(std::move(oracle));
+  }
+  int check(const std::string &program);
+
+private:
+  std::vector<std::unique_ptr<Oracle>> Oracles;
+};
+
+#endif // INCLUDE_ORACLE_H_
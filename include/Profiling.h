@@ -1,6 +1,8 @@
 #ifndef INCLUDE_PROFILING_H_
 #define INCLUDE_PROFILING_H_
 
+#include <string>
+
 class Profiler {
 public:
   Profiler();
@@ -9,10 +11,42 @@ public:
   double getElapsedTime();
 
 private:
-  __int128_t begin;
-  __int128_t end;
-  __int128_t elapsed = 0;
-  __int128_t getTimeMs();
+  long long begin; // steady_clock nanoseconds
+  long long end;
+  long long elapsed = 0;
+};
+
+// Spans of the run in Chrome trace-event format (--trace FILE). Every thread
+// records into its own buffer, and nothing is recorded unless enabled.
+class Trace {
+public:
+  static void enable();
+  static bool isEnabled() { return enabled; }
+  static long long now(); // steady_clock nanoseconds
+  // records [begin, now) as a span of the calling thread
+  static void complete(const std::string &name, const char *category,
+                       long long begin, const std::string &detail = "");
+  static bool write(const std::string &file);
+
+private:
+  static bool enabled;
+  static long long origin;
+};
+
+// Records its own lifetime as a span, so spans nest with the scopes.
+class Span {
+public:
+  Span(const std::string &name, const char *category,
+       const std::string &detail = "");
+  ~Span();
+
+private:
+  std::string name;
+  const char *category;
+  std::string detail;
+  long long begin;
+  Span(const Span &);
+  void operator=(const Span &);
 };
 
 #endif // INCLUDE_PROFILING_H_
@@ -0,0 +1,103 @@
+#ifndef INCLUDE_REDUCTION_SESSION_H_
+#define INCLUDE_REDUCTION_SESSION_H_
+
+#include <functional>
+#include <string>
+
+// Knobs of one reduction; the defaults match a plain chisel run.
+struct ReductionOptions {
+  bool global = true;
+  bool local = true;
+  bool token = false;
+  bool linePrepass = false;
+  bool memoize = false;
+  bool globalDep = true;
+  bool localDep = true;
+  bool dce = true;
+  // command oracles run in parallel, each in a sandbox of the private
+  // directory; a callback always sees one candidate at a time
+  int jobs = 1;
+  int timeBudget = 0; // seconds, 0 for none
+  // where the private working directory of a run is created
+  std::string workDir = "/tmp";
+};
+
+struct ReductionStats {
+  unsigned oracleCalls = 0;
+  unsigned successfulCalls = 0;
+  // bytes that are not whitespace, as in the report
+  unsigned long originalBytes = 0;
+  unsigned long finalBytes = 0;
+  double seconds = 0;
+  double oracleSeconds = 0;
+  double parseSeconds = 0;
+};
+
+struct ReductionResult {
+  bool ok = false;
+  std::string error;
+  std::string program;
+  ReductionStats stats;
+};
+
+// Reduces a program held in memory, for embedding chisel in a long-lived
+// process:
+//
+//   ReductionSession session(text);
+//   session.setOracle([](const std::string &p) { return keeps(p); });
+//   ReductionResult result = session.run();
+//
+// The passes still read process-wide state (Option, Report, the memo, the
+// budget and the Clang instance), so run() forks: the reduction happens in a
+// child with its own copy of that state, working in the private directory of
+// the session. The callback is called in the thread of run(), one candidate
+// at a time. Neither the state nor the working directory of the calling
+// process changes, and sessions in different threads run side by side.
+class ReductionSession {
+public:
+  typedef std::function<bool(const std::string &program)> Callback;
+
+  enum Strategy {
+    // global and local reduction to a fixpoint, then tokens if options().token
+    Fixpoint,
+    // one global and one local pass, then tokens if options().token
+    SinglePass,
+    // the line prepass only; nothing is parsed
+    Lines
+  };
+
+  explicit ReductionSession(const std::string &program,
+                            const std::string &name = "input.c")
+      : Program(program), Name(name), Mode(Fixpoint) {}
+
+  // an in-process check; true keeps the program
+  void setOracle(const Callback &callback) {
+    Check = callback;
+    Command.clear();
+  }
+  // a shell command run in the directory of the candidate, saved as name
+  void setOracle(const std::string &command) {
+    Command = command;
+    Check = nullptr;
+  }
+  void setStrategy(Strategy strategy) { Mode = strategy; }
+  ReductionOptions &options() { return Options; }
+
+  ReductionResult run();
+
+  // Runs the phases of strategy on Option::inputFile with the oracle of
+  // the process; the chisel executable and every session go through here.
+  static void reduceFile(Strategy strategy);
+
+private:
+  void reduceInChild(const std::string &dir, int requests, int replies);
+
+  std::string Program;
+  std::string Name;
+  Callback Check;
+  std::string Command;
+  Strategy Mode;
+  ReductionOptions Options;
+};
+
+#endif // INCLUDE_REDUCTION_SESSION_H_
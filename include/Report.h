@@ -1,19 +1,43 @@
 #ifndef INCLUDE_REPORT_H_
 #define INCLUDE_REPORT_H_
 
+#include <map>
+#include <string>
+#include <vector>
+
 #include "Counting.h"
 #include "Profiling.h"
+#include "Stats.h"
 
 class Report {
 public:
   static Profiler totalProfiler;
   static Profiler learningProfiler;
   static Profiler oracleProfiler;
+  static Profiler parseProfiler;
   static Counter globalCallsCounter;
   static Counter localCallsCounter;
   static Counter successfulGlobalCallsCounter;
   static Counter successfulLocalCallsCounter;
+  static Counter tokenCallsCounter;
+  static Counter successfulTokenCallsCounter;
+  static Counter lineCallsCounter;
+  static Counter successfulLineCallsCounter;
+  static Counter memoHitsCounter;
+  // oracle calls, successes and time per callOracle kind
+  static std::map<std::string, Counter> callsByKind;
+  static std::map<std::string, Counter> successfulCallsByKind;
+  static std::map<std::string, Profiler> oracleProfilerByKind;
+  // seconds per oracle call
+  static std::vector<double> oracleTimes;
+  static Stats::Sizes originalSizes;
+  static Stats::Sizes finalSizes;
+  static double getSuccessRate(const std::string &kind);
+  static double getMeanOracleTime(const std::string &kind);
+  // back to an empty report, for the next run in the same process
+  static void reset();
   static void print();
+  static bool writeJson(const std::string &file);
 };
 
 #endif // INCLUDE_REPORT_H_
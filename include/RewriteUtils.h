@@ -5,6 +5,8 @@
 #include "clang/Basic/SourceLocation.h"
 #include <string>
 
+#include "DelimiterIndex.h"
+
 #ifndef ENABLE_TRANS_ASSERT
 #define TransAssert(x)                                                         \
   {                                                                            \
@@ -253,8 +255,13 @@ private:
 
   clang::SourceManager *SrcManager;
 
+  // delimiters of the main file, built on the first query after a new parse
+  DelimiterIndex Delimiters;
+
   RewriteUtils(void) : TheRewriter(NULL), SrcManager(NULL) {}
 
+  const DelimiterIndex &getDelimiterIndex(void);
+
   ~RewriteUtils(void) {}
 
   int getOffsetUntil(const char *Buf, char Symbol);
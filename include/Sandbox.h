@@ -0,0 +1,24 @@
+#ifndef INCLUDE_SANDBOX_H_
+#define INCLUDE_SANDBOX_H_
+
+#include <string>
+
+// A private working directory in which an oracle can run on its own copy of
+// the input. Every entry of the current directory is symlinked into it,
+// except the directories on the path to the input file, which are recreated,
+// and the input file itself, which the caller writes. An oracle that writes
+// scratch files next to the input needs --copy_sandbox, which copies the
+// regular files instead, at the cost of a copy per candidate.
+class Sandbox {
+public:
+  static bool isSupported();
+  static std::string getPath(int id);
+  static bool create(const std::string &dir);
+  static void remove(const std::string &dir);
+
+private:
+  static bool mirror(const std::string &from, const std::string &to,
+                     const std::string &path);
+};
+
+#endif // INCLUDE_SANDBOX_H_
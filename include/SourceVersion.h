@@ -0,0 +1,77 @@
+#ifndef INCLUDE_SOURCE_VERSION_H_
+#define INCLUDE_SOURCE_VERSION_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A version of the main file: the original text with a set of blanked byte
+// ranges, kept in a persistent treap. Blanking returns a new version sharing
+// all but O(log n) nodes with the old one, so a rejected candidate is reverted
+// by dropping its version. Blanked bytes are served from a placeholder copy of
+// the original made once, and files are written with writev over the pieces.
+class SourceVersion {
+public:
+  // [begin, end) byte offsets
+  typedef std::pair<unsigned, unsigned> Range;
+
+  SourceVersion() : Blanked(0) {}
+
+  explicit SourceVersion(const std::string &Original);
+
+  SourceVersion blank(Range R) const;
+
+  SourceVersion blank(const std::vector<Range> &Ranges) const;
+
+  unsigned size() const;
+
+  // bytes covered by blanked ranges
+  unsigned getBlankedSize() const { return Blanked; }
+
+  // of the text, without building it
+  unsigned long long hash() const;
+
+  std::string str() const;
+
+  std::string getText(Range R) const;
+
+  // blanked ranges overlapping R, in order
+  std::vector<Range> getBlanks(Range R) const;
+
+  bool writeToFile(const std::string &Filename) const;
+
+private:
+  struct Buffers {
+    std::string Original;
+    std::string Blank;
+  };
+
+  struct Node;
+  typedef std::shared_ptr<const Node> NodePtr;
+  struct Node {
+    unsigned Begin;
+    unsigned End;
+    unsigned Priority;
+    NodePtr Left;
+    NodePtr Right;
+  };
+
+  static NodePtr makeNode(unsigned Begin, unsigned End, const NodePtr &Left,
+                          const NodePtr &Right);
+  static NodePtr merge(const NodePtr &L, const NodePtr &R);
+  static void split(const NodePtr &T, unsigned Key, NodePtr &L, NodePtr &R);
+  static const Node *getMax(const NodePtr &T);
+  static NodePtr removeMax(const NodePtr &T);
+  static void collect(const NodePtr &T, Range R, std::vector<Range> &Out);
+  static unsigned getLength(const NodePtr &T);
+
+  // the pieces of R, alternating between original and blanked text
+  template <typename F> void forEachPiece(Range R, F Emit) const;
+
+  std::shared_ptr<const Buffers> Base;
+  NodePtr Root;
+  unsigned Blanked;
+};
+
+#endif // INCLUDE_SOURCE_VERSION_H_
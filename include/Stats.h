@@ -1,8 +1,6 @@
 #ifndef INCLUDE_STATS_H_
 #define INCLUDE_STATS_H_
 
-#include <clang-c/Index.h>
-
 #include <algorithm>
 #include <cstdlib>
 #include <fstream>
@@ -13,7 +11,20 @@
 
 class Stats {
 public:
+  // sizes of a program as the report shows them; bytes leave out whitespace,
+  // which is what blanking leaves behind, and statements are the children of
+  // compound statements in the main file
+  struct Sizes {
+    unsigned long bytes = 0;
+    unsigned long tokens = 0;
+    unsigned long statements = 0;
+    unsigned long functions = 0;
+  };
+
   static int getWordCount(const char *srcPath);
+  // bytes of source that are not whitespace
+  static unsigned long getByteCount(const std::string &source);
+  static Sizes getSizes(const char *srcPath);
 };
 
 #endif // INCLUDE_STATS_H_
@@ -0,0 +1,27 @@
+#ifndef INCLUDE_STATUS_H_
+#define INCLUDE_STATUS_H_
+
+#include <string>
+
+// Live progress of a run (--status FILE). The passes only bump relaxed
+// atomic counters; a background thread snapshots them once a second and
+// replaces FILE with a small JSON object.
+class Status {
+public:
+  static void start(const std::string &file);
+  static void stop();
+
+  static void setPhase(const std::string &phase);
+  static void setIteration(int iteration);
+  // a ddmin round over elements split into subsets
+  static void startRound(unsigned elements, unsigned subsets);
+  static void nextCandidate();
+  static void countCalls(unsigned calls, unsigned successes);
+  // non-whitespace bytes of the best program so far (Stats::getByteCount)
+  static void setSize(unsigned long bytes);
+
+private:
+  static void write();
+};
+
+#endif // INCLUDE_STATUS_H_
@@ -10,4 +10,8 @@ public:
                                  const std::string &replaceWith);
   static bool contains(std::string str, std::string what);
   static std::string placeholder(std::string str);
+  // FNV-1a; pass the previous result as seed to hash in pieces
+  static unsigned long long
+  hash(const char *data, size_t size,
+       unsigned long long seed = 14695981039346656037ULL);
 };
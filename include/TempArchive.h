@@ -0,0 +1,50 @@
+#ifndef INCLUDE_TEMP_ARCHIVE_H_
+#define INCLUDE_TEMP_ARCHIVE_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// The --save_temp intermediates as one append-only file. Every parse stores
+// its source once as a base; every oracle call then only stores the byte
+// ranges its candidate blanked on top of that base. Records are appended with
+// a single write(2) to an O_APPEND file, so forked workers can share it.
+// chisel-extract rebuilds the candidates.
+//
+//   base ID SIZE\n<SIZE bytes>\n
+//   candidate BASE SIZE\n<SIZE bytes of name>\nCOUNT\n(BEGIN END\n){COUNT}
+//
+// Names are length-prefixed like bases, since they contain the input file
+// name, which may have spaces.
+class TempArchive {
+public:
+  // [begin, end) byte offsets
+  typedef std::pair<unsigned, unsigned> Range;
+
+  struct Candidate {
+    int base;
+    std::string name;
+    std::vector<Range> blanks;
+  };
+
+  static const char *FileName;
+
+  static bool open(const std::string &file);
+  static bool isOpen() { return fd >= 0; }
+  static void close();
+  // returns the id of the base, or -1
+  static int addBase(const std::string &text);
+  static void addCandidate(int base, const std::string &name,
+                           const std::vector<Range> &blanks);
+
+  static bool read(const std::string &file, std::vector<std::string> &bases,
+                   std::vector<Candidate> &candidates);
+  static std::string rebuild(const std::string &base,
+                             const std::vector<Range> &blanks);
+
+private:
+  static int fd;
+  static int bases;
+};
+
+#endif // INCLUDE_TEMP_ARCHIVE_H_
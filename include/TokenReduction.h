@@ -0,0 +1,33 @@
+#ifndef TOKEN_REDUCTION_H
+#define TOKEN_REDUCTION_H
+
+#include "Transformation.h"
+#include <string>
+#include <vector>
+
+namespace clang {
+class ASTContext;
+} // namespace clang
+
+class TokenReduction : public Transformation {
+public:
+  TokenReduction(const char *TransName, const char *Desc)
+      : Transformation(TransName, Desc), BaseErrors(0) {}
+
+  ~TokenReduction(void);
+
+private:
+  virtual void HandleTranslationUnit(clang::ASTContext &Ctx);
+  void tokenReduction(void);
+  void collectCandidates(std::vector<Range> &tokens,
+                         std::vector<Range> &groups);
+  void ddmin(std::vector<Range> ranges);
+  bool test(std::vector<Range> &toBeRemoved);
+
+  TokenReduction(void);
+  TokenReduction(const TokenReduction &);
+  void operator=(const TokenReduction &);
+
+  unsigned BaseErrors;
+};
+#endif
@@ -2,6 +2,7 @@
 #define TRANSFORMATION_H
 
 #include "RewriteUtils.h"
+#include "SourceVersion.h"
 #include "clang/AST/ASTConsumer.h"
 #include "clang/Basic/SourceLocation.h"
 #include "clang/Rewrite/Core/Rewriter.h"
@@ -9,6 +10,8 @@
 #include <cassert>
 #include <cstdlib>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace clang {
 class CompilerInstance;
@@ -55,6 +58,7 @@ public:
   Transformation(const char *TransName, const char *Desc)
       : Name(TransName), TransformationCounter(-1), ValidInstanceNum(0),
         QueryInstanceOnly(false), Context(NULL), SrcManager(NULL),
+        NodeKind(NULL), ArchiveBase(-1), ParseBegin(0),
         TransError(TransSuccess), DescriptionString(Desc), RewriteHelper(NULL),
         Rewritten(false), MultipleRewrites(false), ToCounter(-1),
         DoReplacement(false), CheckReference(false) {
@@ -65,6 +69,7 @@ public:
                  bool MultipleRewritesFlag)
       : Name(TransName), TransformationCounter(-1), ValidInstanceNum(0),
         QueryInstanceOnly(false), Context(NULL), SrcManager(NULL),
+        NodeKind(NULL), ArchiveBase(-1), ParseBegin(0),
         TransError(TransSuccess), DescriptionString(Desc), RewriteHelper(NULL),
         Rewritten(false), MultipleRewrites(MultipleRewritesFlag), ToCounter(-1),
         DoReplacement(false), CheckReference(false) {
@@ -116,7 +121,21 @@ public:
 
   virtual bool skipCounter() { return false; }
 
+  // parse without building function bodies
+  virtual bool skipFunctionBodies() { return false; }
+
+  // drops the text of the last parse once its AST is gone
+  void releaseSource() {
+    Source = SourceVersion();
+    Best = SourceVersion();
+    Context = NULL;
+    SrcManager = NULL;
+  }
+
 protected:
+  // [begin, end) byte offsets in the main file
+  typedef std::pair<unsigned, unsigned> Range;
+
   typedef llvm::SmallVector<unsigned int, 10> IndexVector;
 
   typedef llvm::SmallVector<const clang::ArrayType *, 10> ArraySubTypeVector;
@@ -247,6 +266,21 @@ protected:
 
   clang::Rewriter TheRewriter;
 
+  // the main file as edited so far; candidates are versions derived from it
+  SourceVersion Source;
+
+  // the last version the oracle accepted
+  SourceVersion Best;
+
+  // the hdd node being reduced, for the event log
+  const char *NodeKind;
+
+  // this parse's source in the --save_temp archive
+  int ArchiveBase;
+
+  // when the current parse started, for its trace span
+  long long ParseBegin;
+
   TransformationError TransError;
 
   std::string DescriptionString;
@@ -269,11 +303,40 @@ protected:
 
   std::string getSourceText(clang::SourceRange SR);
 
+  std::string getRewrittenSource();
+
+  bool getByteRange(clang::SourceRange SR, Range &R);
+
+  bool getByteRanges(const std::vector<clang::SourceRange> &SRs,
+                     std::vector<Range> &Rs);
+
+  std::string getRewrittenText(Range R);
+
+  clang::SourceLocation getEndLocation(clang::Stmt *last);
+
   void writeToFile(std::string filename);
 
+  // goes back to Version after a rejected candidate
+  void revert(const SourceVersion &Version);
+
+  // ends the trace span of the parse; called first in HandleTranslationUnit
+  void endParse();
+
   void printToTerminal();
 
   bool callOracle(std::string msg);
+
+  std::vector<bool> callOracles(const std::vector<SourceVersion> &versions,
+                                std::string msg);
+
+  void saveBest();
+
+  void publishSize();
+
+  void saveTemp(const std::string &name, const SourceVersion &candidate);
+
+  void logCall(const std::string &msg, const SourceVersion &candidate,
+               int status, double wall, double cpu);
 };
 
 class TransNameQueryVisitor;
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -13,6 +14,7 @@
 
 class Transformation;
 namespace clang {
+class ASTConsumer;
 class CompilerInstance;
 class Preprocessor;
 class Decl;
@@ -32,6 +34,11 @@ public:
 
   static clang::Preprocessor &getPreprocessor();
 
+  static unsigned getNumParseErrors(const std::string &Source);
+
+  static unsigned parse(const std::string &Source, const std::string &Name,
+                        std::unique_ptr<clang::ASTConsumer> Consumer);
+
   static int ErrorInvalidCounter;
 
   bool doTransformation(std::string &ErrorMsg, int &ErrorCode);
@@ -56,8 +63,8 @@ public:
     ToCounter = Counter;
   }
 
+  // a file at a time; every ReductionSession sets its own
   void setSrcFileName(const std::string &FileName) {
-    assert(SrcFileName.empty() && "Could only process one file each time");
     SrcFileName = FileName;
   }
 
@@ -71,6 +78,8 @@ public:
 
   bool initializeCompilerInstance(std::string &ErrorMsg);
 
+  void releaseCompilerInstance();
+
   void outputNumTransformationInstances();
 
   void printTransformations();
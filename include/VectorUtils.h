@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <map>
 #include <vector>
 
 class VectorUtils {
@@ -18,6 +20,49 @@ public:
     return result;
   }
 
+  // Splits vec into n contiguous subsets whose total weights are as even as
+  // possible, keeping at least one element in each subset.
+  template <typename T>
+  static std::vector<std::vector<T>>
+  splitByWeight(std::vector<T> &vec, int n, std::map<T, unsigned> &weights) {
+    std::vector<std::vector<T>> result;
+    int size = static_cast<int>(vec.size());
+    int parts = std::min(n, size);
+
+    unsigned long long remaining = 0;
+    for (auto const &v : vec)
+      remaining += weights[v];
+
+    int begin = 0, end = 0;
+    for (int i = 0; i < parts; ++i) {
+      int left = parts - i;
+      unsigned long long acc = weights[vec[begin]];
+      end = begin + 1;
+      if (left == 1) {
+        end = size;
+      } else {
+        // take the next element while it brings the subset closer to an even
+        // share of what is left, i.e. acc + w / 2 <= remaining / left
+        while (end < size - (left - 1) &&
+               left * (2 * acc + weights[vec[end]]) <= 2 * remaining)
+          acc += weights[vec[end++]];
+      }
+      result.emplace_back(
+          std::vector<T>(vec.begin() + begin, vec.begin() + end));
+      remaining -= std::min(remaining, acc);
+      begin = end;
+    }
+    return result;
+  }
+
+  // Orders vec by descending weight, keeping the original order among equals.
+  template <typename T>
+  static void sortByWeight(std::vector<T> &vec, std::map<T, unsigned> &weights) {
+    std::stable_sort(vec.begin(), vec.end(), [&weights](const T &a, const T &b) {
+      return weights[a] > weights[b];
+    });
+  }
+
   template <typename T> static bool contains(std::vector<T> &vec, T d) {
     for (auto const &v : vec)
       if (v == d)
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <getopt.h>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+const std::string usage(
+    "Usage: chisel-bench [OPTIONS]... CORPUS\n"
+    "Options:\n"
+    "  --chisel PATH          chisel binary (default: next to chisel-bench)\n"
+    "  --work_dir DIR         Where the programs are reduced (default: "
+    "chisel-bench-out)\n"
+    "  --output FILE          Write the results to FILE\n"
+    "  --baseline FILE        Compare against earlier results, exit 1 on a "
+    "regression\n"
+    "  --tolerance PERCENT    Allowed slowdown over the baseline (default: "
+    "10)\n"
+    "  --deterministic        Write only oracle_calls and final_bytes to "
+    "FILE,\n"
+    "                         '-' for the machine-dependent columns\n"
+    "  --repeat N             Reduce every program N times, keep the fastest");
+
+// One line of the corpus: NAME SOURCE ORACLE [CHISEL OPTIONS]...
+struct Benchmark {
+  std::string name;
+  std::string source;
+  std::string oracle;
+  std::vector<std::string> options;
+};
+
+struct Result {
+  double wall = 0;
+  double cpu = 0; // chisel itself, without the oracles
+  double rss = 0; // MB
+  unsigned long calls = 0;
+  unsigned long bytes = 0;
+};
+
+static const char *Columns[] = {"wall_seconds", "cpu_seconds", "peak_rss_mb",
+                                "oracle_calls", "final_bytes"};
+
+static std::string getDirName(const std::string &path) {
+  size_t slash = path.rfind('/');
+  return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+static std::string getAbsolutePath(const std::string &path) {
+  char *real = realpath(path.c_str(), NULL);
+  if (real == NULL)
+    return path;
+  std::string result(real);
+  free(real);
+  return result;
+}
+
+static bool readCorpus(const std::string &file,
+                       std::vector<Benchmark> &corpus) {
+  std::ifstream ifs(file);
+  if (!ifs)
+    return false;
+  // paths are relative to the corpus file
+  std::string dir = getDirName(getAbsolutePath(file));
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream iss(line);
+    Benchmark benchmark;
+    if (!(iss >> benchmark.name >> benchmark.source >> benchmark.oracle))
+      return false;
+    benchmark.source = dir + "/" + benchmark.source;
+    benchmark.oracle = dir + "/" + benchmark.oracle;
+    std::string option;
+    while (iss >> option)
+      benchmark.options.emplace_back(option);
+    corpus.emplace_back(benchmark);
+  }
+  return true;
+}
+
+// the number after "key": in a flat search from pos, as chisel writes it
+static double getNumber(const std::string &json, const std::string &key,
+                        size_t pos = 0) {
+  pos = json.find("\"" + key + "\":", pos);
+  if (pos == std::string::npos)
+    return 0;
+  return strtod(json.c_str() + pos + key.size() + 3, NULL);
+}
+
+static bool copyFile(const std::string &from, const std::string &to) {
+  std::ifstream src(from, std::ios::binary);
+  std::ofstream dst(to, std::ios::binary);
+  dst << src.rdbuf();
+  return src && dst;
+}
+
+static bool run(const std::string &chisel, const std::string &workDir,
+                const Benchmark &benchmark, Result &result) {
+  // every run starts from a fresh copy of the program
+  std::string dir = workDir + "/" + benchmark.name;
+  std::string source = benchmark.name + ".c";
+  mkdir(dir.c_str(), ACCESSPERMS);
+  if (!copyFile(benchmark.source, dir + "/" + source))
+    return false;
+  std::remove((dir + "/report.json").c_str());
+
+  std::vector<std::string> args = {chisel, "--no_profile", "--report_json",
+                                   "report.json"};
+  args.insert(args.end(), benchmark.options.begin(), benchmark.options.end());
+  args.emplace_back(benchmark.oracle);
+  args.emplace_back(source);
+  std::vector<char *> argv;
+  for (auto &arg : args)
+    argv.emplace_back(&arg[0]);
+  argv.emplace_back(nullptr);
+
+  auto begin = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid == 0) {
+    if (chdir(dir.c_str()) != 0 || !freopen("chisel.log", "w", stdout) ||
+        dup2(fileno(stdout), 2) < 0)
+      _exit(127);
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+  if (pid < 0)
+    return false;
+  int status;
+  if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0)
+    return false;
+  result.wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+
+  std::ifstream ifs(dir + "/report.json");
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  std::string json = buffer.str();
+  if (json.empty())
+    return false;
+  result.cpu = getNumber(json, "chisel", json.find("\"cpu\":"));
+  result.rss = getNumber(json, "peak_rss") / (1024 * 1024);
+  result.calls = getNumber(json, "oracle_calls");
+  // non-whitespace bytes; blanking keeps the length of the file itself
+  result.bytes = getNumber(json, "bytes", json.find("\"final\":"));
+  return true;
+}
+
+static std::vector<double> getValues(const Result &result) {
+  return {result.wall, result.cpu, result.rss,
+          static_cast<double>(result.calls),
+          static_cast<double>(result.bytes)};
+}
+
+// deterministic leaves out the timings and memory, which depend on the
+// machine, so that the results can be checked in as a baseline
+static bool writeResults(std::ostream &out,
+                         const std::vector<std::string> &names,
+                         std::map<std::string, Result> &results,
+                         bool deterministic = false) {
+  out << "name";
+  for (auto column : Columns)
+    out << "\t" << column;
+  out << "\n";
+  for (auto const &name : names) {
+    Result &result = results[name];
+    out << name << std::fixed << std::setprecision(3);
+    if (deterministic)
+      out << "\t-\t-\t-";
+    else
+      out << "\t" << result.wall << "\t" << result.cpu << "\t" << result.rss;
+    out << "\t" << result.calls << "\t" << result.bytes << "\n";
+  }
+  return static_cast<bool>(out);
+}
+
+static bool readResults(const std::string &file,
+                        std::map<std::string, std::vector<double>> &results) {
+  std::ifstream ifs(file);
+  std::string line;
+  if (!std::getline(ifs, line))
+    return false;
+  while (std::getline(ifs, line)) {
+    std::istringstream iss(line);
+    std::string name;
+    std::vector<double> values(sizeof(Columns) / sizeof(Columns[0]));
+    if (!(iss >> name))
+      continue;
+    // '-' marks a column that is not compared
+    for (auto &value : values) {
+      std::string field;
+      iss >> field;
+      value = field == "-" ? NAN : atof(field.c_str());
+    }
+    results[name] = values;
+  }
+  return true;
+}
+
+// Times and memory may drift within the tolerance plus a little absolute
+// slack for tiny programs; oracle calls and the final size are deterministic,
+// so any increase is a regression.
+static bool compare(const std::vector<std::string> &names,
+                    std::map<std::string, Result> &results,
+                    std::map<std::string, std::vector<double>> &baseline,
+                    double tolerance) {
+  const double slack[] = {0.1, 0.1, 1, 0, 0};
+  bool regressed = false;
+  std::cout << std::fixed << std::setprecision(3);
+  for (auto const &name : names) {
+    if (!baseline.count(name)) {
+      std::cout << name << ": not in the baseline" << std::endl;
+      continue;
+    }
+    std::vector<double> values = getValues(results[name]);
+    for (unsigned i = 0; i < values.size(); i++) {
+      double old = baseline[name][i];
+      if (std::isnan(old))
+        continue;
+      double allowed = slack[i] == 0 ? old
+                                     : std::max(old * (1 + tolerance / 100),
+                                                old + slack[i]);
+      if (values[i] <= allowed)
+        continue;
+      std::cout << name << ": " << Columns[i] << " " << old << " -> "
+                << values[i] << std::endl;
+      regressed = true;
+    }
+  }
+  return !regressed;
+}
+
+static struct option long_options[] = {
+    {"help", no_argument, 0, 'h'},
+    {"chisel", required_argument, 0, 'c'},
+    {"work_dir", required_argument, 0, 'w'},
+    {"output", required_argument, 0, 'o'},
+    {"baseline", required_argument, 0, 'b'},
+    {"deterministic", no_argument, 0, 'd'},
+    {"tolerance", required_argument, 0, 't'},
+    {"repeat", required_argument, 0, 'r'},
+    {0, 0, 0, 0}};
+
+int main(int argc, char **argv) {
+  std::string chisel = getDirName(argv[0]) + "/chisel";
+  std::string workDir = "chisel-bench-out";
+  std::string output, baselineFile;
+  double tolerance = 10;
+  bool deterministic = false;
+  int repeat = 1;
+  int c;
+  while ((c = getopt_long(argc, argv, "hc:w:o:b:dt:r:", long_options, 0)) !=
+         -1) {
+    switch (c) {
+    case 'c':
+      chisel = optarg;
+      break;
+    case 'w':
+      workDir = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'b':
+      baselineFile = optarg;
+      break;
+    case 'd':
+      deterministic = true;
+      break;
+    case 't':
+      tolerance = atof(optarg);
+      break;
+    case 'r':
+      repeat = std::max(atoi(optarg), 1);
+      break;
+    default:
+      std::cerr << usage << std::endl;
+      return c == 'h' ? 0 : 1;
+    }
+  }
+  if (optind + 1 != argc) {
+    std::cerr << usage << std::endl;
+    return 1;
+  }
+
+  std::vector<Benchmark> corpus;
+  if (!readCorpus(argv[optind], corpus)) {
+    std::cerr << "chisel-bench: cannot read " << argv[optind] << std::endl;
+    return 1;
+  }
+  std::map<std::string, std::vector<double>> baseline;
+  if (!baselineFile.empty() && !readResults(baselineFile, baseline)) {
+    std::cerr << "chisel-bench: cannot read the baseline " << baselineFile
+              << "; record one with make bench-baseline" << std::endl;
+    return 1;
+  }
+  mkdir(workDir.c_str(), ACCESSPERMS);
+  chisel = getAbsolutePath(chisel);
+  workDir = getAbsolutePath(workDir);
+
+  std::vector<std::string> names;
+  std::map<std::string, Result> results;
+  bool failed = false;
+  for (auto const &benchmark : corpus) {
+    // the reduction itself is deterministic; repeats only tame the timings
+    Result best;
+    bool ok = true;
+    for (int i = 0; i < repeat && ok; i++) {
+      Result result;
+      ok = run(chisel, workDir, benchmark, result);
+      if (i == 0 || result.wall < best.wall)
+        best = result;
+    }
+    if (!ok) {
+      std::cerr << "chisel-bench: " << benchmark.name << " failed, see "
+                << workDir << "/" << benchmark.name << "/chisel.log"
+                << std::endl;
+      failed = true;
+      continue;
+    }
+    names.emplace_back(benchmark.name);
+    results[benchmark.name] = best;
+  }
+
+  writeResults(std::cout, names, results);
+  if (!output.empty()) {
+    std::ofstream ofs(output);
+    if (!writeResults(ofs, names, results, deterministic)) {
+      std::cerr << "chisel-bench: cannot write " << output << std::endl;
+      return 1;
+    }
+  }
+  if (!baseline.empty() && !compare(names, results, baseline, tolerance))
+    return 1;
+  return failed ? 1 : 0;
+}
@@ -1,22 +1,29 @@
 #if HAVE_CONFIG_H
 #include <config.h>
 #endif
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
 #include <sys/stat.h>
 
+#include "Budget.h"
+#include "EventLog.h"
+#include "Memory.h"
 #include "Options.h"
+#include "Oracle.h"
+#include "Profiling.h"
+#include "ReductionSession.h"
 #include "Report.h"
 #include "Stats.h"
+#include "Status.h"
+#include "TempArchive.h"
 #include "TransformationManager.h"
 #include "llvm/Support/raw_ostream.h"
 
-static TransformationManager *TransMgr;
-int ErrorCode = -1;
-std::string ErrorMsg = "error";
 void stat() {
   // auto stats = Stats::getStatementCount(Option::inputFile.c_str());
   auto stats = Stats::getWordCount(Option::inputFile.c_str());
@@ -26,6 +33,16 @@ void stat() {
   exit(0);
 }
 
+void copyFile(const std::string &from, const std::string &to) {
+  std::string temp = to + ".tmp";
+  std::ifstream src(from, std::ios::binary);
+  std::ofstream dst(temp, std::ios::binary);
+  dst << src.rdbuf();
+  dst.close();
+  if (dst)
+    std::rename(temp.c_str(), to.c_str());
+}
+
 int main(int argc, char **argv) {
   Option::handleOptions(argc, argv);
 
@@ -33,37 +50,56 @@ int main(int argc, char **argv) {
     stat();
   mkdir(Option::outputDir.c_str(), ACCESSPERMS);
 
-  if (Option::profile)
-    Report::totalProfiler.startTimer();
+  bool report = Option::profile || !Option::reportJson.empty();
+  Report::totalProfiler.startTimer();
+  if (!Option::traceFile.empty())
+    Trace::enable();
+  if (!Option::eventLog.empty() && !EventLog::open(Option::eventLog))
+    std::cerr << "chisel: cannot write " << Option::eventLog << std::endl;
+  std::string archive = Option::outputDir + "/" + TempArchive::FileName;
+  if (Option::saveTemp && !TempArchive::open(archive))
+    std::cerr << "chisel: cannot write " << archive << std::endl;
 
-  TransMgr = TransformationManager::GetInstance();
-  TransMgr->setSrcFileName(Option::inputFile);
+  // in anytime mode the output always holds the best program so far
+  Budget::start(Option::timeBudget);
+  Memory::setLimit(Option::maxRSS);
+  if (Budget::isLimited())
+    copyFile(Option::inputFile, Option::outputFile);
 
-  int wc = 0, wc0 = 0;
-  while (true) {
-    wc0 = Stats::getWordCount(Option::inputFile.c_str());
+  TransformationManager::GetInstance()->setSrcFileName(Option::inputFile);
+  std::string error;
+  if (!Oracle::setUp(Option::oracleFile, error)) {
+    std::cerr << "chisel: " << error << std::endl;
+    return 1;
+  }
+  if (report)
+    Report::originalSizes = Stats::getSizes(Option::inputFile.c_str());
+  if (!Option::statusFile.empty()) {
+    std::ifstream ifs(Option::inputFile, std::ios::binary);
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    Status::setSize(Stats::getByteCount(buffer.str()));
+    Status::start(Option::statusFile);
+  }
 
-    if (!Option::skipGlobal) {
-      TransMgr->setTransformation("global-reduction");
-      TransMgr->initializeCompilerInstance(ErrorMsg);
-      TransMgr->doTransformation(ErrorMsg, ErrorCode);
-    }
-    if (!Option::skipLocal) {
-      TransMgr->setTransformation("local-reduction");
-      TransMgr->initializeCompilerInstance(ErrorMsg);
-      TransMgr->doTransformation(ErrorMsg, ErrorCode);
-    }
+  ReductionSession::reduceFile(ReductionSession::Fixpoint);
 
-    wc = Stats::getWordCount(Option::inputFile.c_str());
-    if (wc == wc0)
-      break;
-  }
+  if (Budget::isLimited())
+    copyFile(Option::inputFile, Option::outputFile);
 
-  if (Option::profile)
-    Report::totalProfiler.stopTimer();
+  Report::totalProfiler.stopTimer();
+  if (report)
+    Report::finalSizes = Stats::getSizes(Option::inputFile.c_str());
 
   TransformationManager::Finalize();
+  Status::stop();
+  EventLog::close();
+  TempArchive::close();
+  if (!Option::traceFile.empty() && !Trace::write(Option::traceFile))
+    std::cerr << "chisel: cannot write " << Option::traceFile << std::endl;
   if (Option::profile)
     Report::print();
+  if (!Option::reportJson.empty() && !Report::writeJson(Option::reportJson))
+    std::cerr << "chisel: cannot write " << Option::reportJson << std::endl;
   return 0;
 }
@@ -0,0 +1,179 @@
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+
+#include <algorithm>
+
+#include "Budget.h"
+#include "Coverage.h"
+#include "CoverageReduction.h"
+#include "Options.h"
+#include "Status.h"
+#include "TransformationManager.h"
+#include "VectorUtils.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg =
+    "Remove code never executed by the oracle's tests";
+
+class CoverageReductionCollectionVisitor
+    : public RecursiveASTVisitor<CoverageReductionCollectionVisitor> {
+public:
+  explicit CoverageReductionCollectionVisitor(CoverageReduction *Instance)
+      : ConsumerInstance(Instance) {}
+
+  bool VisitFunctionDecl(FunctionDecl *FD);
+
+private:
+  CoverageReduction *ConsumerInstance;
+};
+
+static RegisterTransformation<CoverageReduction> Trans("coverage-reduction",
+                                                       DescriptionMsg);
+
+bool CoverageReductionCollectionVisitor::VisitFunctionDecl(FunctionDecl *FD) {
+  if (FD->isThisDeclarationADefinition() &&
+      !ConsumerInstance->isInIncludedFile(FD))
+    ConsumerInstance->functions.emplace_back(FD);
+  return true;
+}
+
+void CoverageReduction::Initialize(ASTContext &context) {
+  Transformation::Initialize(context);
+  functions.clear();
+  if (!CollectionVisitor)
+    CollectionVisitor = new CoverageReductionCollectionVisitor(this);
+}
+
+bool CoverageReduction::HandleTopLevelDecl(DeclGroupRef D) {
+  for (DeclGroupRef::iterator I = D.begin(), E = D.end(); I != E; ++I) {
+    CollectionVisitor->TraverseDecl(*I);
+  }
+  return true;
+}
+
+void CoverageReduction::HandleTranslationUnit(ASTContext &Ctx) {
+  endParse();
+  coverageReduction();
+}
+
+bool CoverageReduction::isUnexecuted(SourceRange range) {
+  // unexecuted only if gcov saw executable lines here and none of them ran
+  unsigned begin = SrcManager->getExpansionLineNumber(range.getBegin());
+  unsigned end = SrcManager->getExpansionLineNumber(range.getEnd());
+  bool executable = false;
+  for (unsigned line = begin; line <= end; line++) {
+    if (Coverage::isExecuted(line))
+      return false;
+    executable |= Coverage::isExecutable(line);
+  }
+  return executable;
+}
+
+void CoverageReduction::collectStatements(Stmt *S,
+                                          std::vector<SourceRange> &v) {
+  if (S == NULL)
+    return;
+  if (CompoundStmt *CS = dyn_cast<CompoundStmt>(S)) {
+    for (CompoundStmt::body_iterator I = CS->body_begin(), E = CS->body_end();
+         I != E; ++I) {
+      SourceLocation begin = (*I)->getSourceRange().getBegin();
+      SourceLocation end = getEndLocation(*I);
+      if (begin.isValid() && end.isValid() &&
+          isUnexecuted((*I)->getSourceRange()))
+        v.emplace_back(SourceRange(begin, end));
+      else
+        collectStatements(*I, v);
+    }
+    return;
+  }
+  for (Stmt::child_iterator I = S->child_begin(), E = S->child_end(); I != E;
+       ++I)
+    collectStatements(*I, v);
+}
+
+bool CoverageReduction::test(std::vector<SourceRange> &toBeRemoved) {
+  std::vector<Range> ranges;
+  if (toBeRemoved.empty() || !getByteRanges(toBeRemoved, ranges))
+    return false;
+  SourceVersion before = Source;
+  Source = Source.blank(ranges);
+  Transformation::writeToFile(Option::inputFile);
+
+  if (Transformation::callOracle("coverage")) {
+    return true;
+  } else {
+    revert(before);
+    return false;
+  }
+}
+
+void CoverageReduction::coverageReduction(void) {
+  // unexecuted functions are removed whole; executed ones lose their
+  // unexecuted statements
+  std::vector<SourceRange> deadFunctions;
+  std::vector<std::vector<SourceRange>> deadStatements;
+  for (auto const &FD : functions) {
+    SourceRange range = FD->getSourceRange();
+    if (!FD->isMain() && isUnexecuted(range)) {
+      deadFunctions.emplace_back(
+          SourceRange(range.getBegin(), range.getEnd().getLocWithOffset(1)));
+    } else {
+      std::vector<SourceRange> stmts;
+      collectStatements(FD->getBody(), stmts);
+      if (!stmts.empty())
+        deadStatements.emplace_back(stmts);
+    }
+  }
+
+  std::vector<SourceRange> all = deadFunctions;
+  for (auto const &stmts : deadStatements)
+    all.insert(all.end(), stmts.begin(), stmts.end());
+  if (Option::verbose)
+    llvm::outs() << "coverage: " << deadFunctions.size()
+                 << " unexecuted functions, " << all.size() - deadFunctions.size()
+                 << " unexecuted statements\n";
+  if (all.empty() || test(all))
+    return;
+
+  // fall back to the functions, then the statements of each function, each
+  // split further by ddmin where removing them together fails
+  ddmin(deadFunctions);
+  for (auto &stmts : deadStatements)
+    ddmin(stmts);
+}
+
+void CoverageReduction::ddmin(std::vector<SourceRange> ranges) {
+  if (ranges.empty() || test(ranges))
+    return;
+  int n = 2;
+  while (ranges.size() >= 1 && !Budget::expired()) {
+    std::vector<std::vector<SourceRange>> subsets =
+        VectorUtils::split<SourceRange>(ranges, n);
+    bool complementSucceeding = false;
+    Status::startRound(ranges.size(), subsets.size());
+
+    // the subsets are consecutive slices of ranges
+    size_t begin = 0;
+    for (auto &subset : subsets) {
+      Status::nextCandidate();
+      if (test(subset)) {
+        ranges.erase(ranges.begin() + begin,
+                     ranges.begin() + begin + subset.size());
+        n = std::max(n - 1, 2);
+        complementSucceeding = true;
+        break;
+      }
+      begin += subset.size();
+    }
+
+    if (!complementSucceeding) {
+      if (n == ranges.size())
+        break;
+      n = std::min(n * 2, static_cast<int>(ranges.size()));
+    }
+  }
+}
+
+CoverageReduction::~CoverageReduction(void) { delete CollectionVisitor; }
@@ -8,14 +8,20 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <future>
 #include <map>
 #include <sstream>
 
+#include "Budget.h"
 #include "CommonStatementVisitor.h"
+#include "ElementMemo.h"
 #include "GlobalReduction.h"
 #include "Options.h"
+#include "Profiling.h"
 #include "Report.h"
 #include "RewriteUtils.h"
+#include "Status.h"
 #include "StringUtils.h"
 #include "TransformationManager.h"
 #include "VectorUtils.h"
@@ -25,10 +31,7 @@ using namespace clang::ast_matchers;
 
 static const char *DescriptionMsg = "Perform global-level reduction";
 
-std::map<FunctionDecl *, SourceRange> functionRanges;
-std::map<Decl *, std::vector<DeclRefExpr *>> refList;
-std::map<DeclRefExpr *, Decl *>
-    whereUsed; // where does this call/access happen?
+static const char *StagingFileName = "chisel-staged";
 
 class GlobalReductionCollectionVisitor
     : public RecursiveASTVisitor<GlobalReductionCollectionVisitor> {
@@ -55,34 +58,20 @@ bool GlobalReductionCollectionVisitor::VisitFunctionDecl(FunctionDecl *FD) {
   if (Option::verbose)
     llvm::outs() << "function decl " << FD->getNameInfo().getAsString() << "\n";
   if (!FD->isMain()) {
-    ConsumerInstance->decls.emplace_back(FD);
+    ConsumerInstance->addDecl(FD);
   }
+  if (FD->hasSkippedBody())
+    ConsumerInstance->skippedBodies.emplace_back(FD);
   return true;
 }
 
 bool GlobalReductionCollectionVisitor::VisitDeclRefExpr(DeclRefExpr *DRE) {
-  if (FunctionDecl *FD = dyn_cast<FunctionDecl>(DRE->getDecl())) {
-    if (FD->isThisDeclarationADefinition()) {
-      whereUsed.insert(std::make_pair(DRE, FD));
-      if (refList.find(FD) != refList.end()) { // found
-        std::vector<DeclRefExpr *> &v_ref = refList[FD];
-        v_ref.emplace_back(DRE);
-      } else { // not found
-        std::vector<DeclRefExpr *> v;
-        v.emplace_back(DRE);
-        refList.insert(std::make_pair(FD, v));
-      }
-    }
-  } else if (VarDecl *VD = dyn_cast<VarDecl>(DRE->getDecl())) {
-    whereUsed.insert(std::make_pair(DRE, VD));
-    if (refList.find(VD) != refList.end()) { // found
-      std::vector<DeclRefExpr *> &v_ref = refList[VD];
-      v_ref.emplace_back(DRE);
-    } else { // not found
-      std::vector<DeclRefExpr *> v;
-      v.emplace_back(DRE);
-      refList.insert(std::make_pair(VD, v));
-    }
+  ValueDecl *D = DRE->getDecl();
+  FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+  if ((FD && FD->isThisDeclarationADefinition()) || isa<VarDecl>(D)) {
+    auto id = ConsumerInstance->DeclIds.find(D);
+    if (id != ConsumerInstance->DeclIds.end())
+      ConsumerInstance->References[id->second]++;
   }
   return true;
 }
@@ -91,13 +80,13 @@ bool GlobalReductionCollectionVisitor::VisitVarDecl(VarDecl *VD) {
   if (VD->hasGlobalStorage()) {
     if (Option::verbose)
       llvm::outs() << "var decl " << VD->getNameAsString() << "\n";
-    ConsumerInstance->decls.emplace_back(VD);
+    ConsumerInstance->addDecl(VD);
   }
   return true;
 }
 
 bool GlobalReductionCollectionVisitor::VisitRecordDecl(RecordDecl *RD) {
-  ConsumerInstance->decls.emplace_back(RD);
+  ConsumerInstance->addDecl(RD);
   if (Option::verbose)
     llvm::outs() << "record decl " << RD->getNameAsString() << "\n";
   return true;
@@ -106,20 +95,36 @@ bool GlobalReductionCollectionVisitor::VisitRecordDecl(RecordDecl *RD) {
 bool GlobalReductionCollectionVisitor::VisitTypedefDecl(TypedefDecl *TD) {
   if (Option::verbose)
     llvm::outs() << "typedef decl " << TD->getNameAsString() << "\n";
-  ConsumerInstance->decls.emplace_back(TD);
+  ConsumerInstance->addDecl(TD);
   return true;
 }
 
 bool GlobalReductionCollectionVisitor::VisitEnumDecl(EnumDecl *ED) {
   if (Option::verbose)
     llvm::outs() << "enum decl " << ED->getNameAsString() << "\n";
-  ConsumerInstance->decls.emplace_back(ED);
+  ConsumerInstance->addDecl(ED);
   return true;
 }
 
 void GlobalReduction::Initialize(ASTContext &context) {
   Transformation::Initialize(context);
-  CollectionVisitor = new GlobalReductionCollectionVisitor(this);
+  decls.clear();
+  DeclIds.clear();
+  References.clear();
+  skippedBodies.clear();
+  BodyEnds.clear();
+  LexicalRefs.clear();
+  if (!CollectionVisitor)
+    CollectionVisitor = new GlobalReductionCollectionVisitor(this);
+}
+
+void GlobalReduction::addDecl(Decl *D) {
+  if (!DeclIds.insert(std::make_pair(D, decls.size())).second)
+    return;
+  decls.emplace_back(D);
+  References.emplace_back(0);
+  BodyEnds.emplace_back(SourceLocation());
+  LexicalRefs.emplace_back(0);
 }
 
 bool GlobalReduction::HandleTopLevelDecl(DeclGroupRef D) {
@@ -130,71 +135,166 @@ bool GlobalReduction::HandleTopLevelDecl(DeclGroupRef D) {
 }
 
 void GlobalReduction::HandleTranslationUnit(ASTContext &Ctx) {
+  endParse();
+  {
+    Span span("collect", "collect");
+    // references from skipped bodies are resolved by name
+    llvm::StringMap<std::vector<unsigned>> globals;
+    for (unsigned i = 0; i < decls.size(); i++) {
+      Decl *d = decls[i];
+      FunctionDecl *FD = dyn_cast<FunctionDecl>(d);
+      if ((FD &&
+           (FD->isThisDeclarationADefinition() || FD->hasSkippedBody())) ||
+          isa<VarDecl>(d))
+        globals[cast<NamedDecl>(d)->getNameAsString()].emplace_back(i);
+    }
+    for (auto const &FD : skippedBodies)
+      scanSkippedBody(FD, globals);
+  }
   globalReduction();
 }
 
-bool GlobalReduction::test(std::vector<clang::Decl *> &toBeRemoved) {
-  const SourceManager *SM = &Context->getSourceManager();
-  std::string revert = "";
-  SourceLocation totalStart, totalEnd;
-  totalStart = toBeRemoved.front()->getSourceRange().getBegin();
-  for (auto const &d : toBeRemoved) {
-    SourceLocation start = d->getSourceRange().getBegin();
-    SourceLocation end;
-
-    FunctionDecl *FD = dyn_cast<FunctionDecl>(d);
-    if (FD && FD->isThisDeclarationADefinition()) {
-      end = FD->getSourceRange().getEnd().getLocWithOffset(1);
-    } else {
-      end = RewriteHelper->getEndLocationUntil(d->getSourceRange(), ';')
-                .getLocWithOffset(1);
+void GlobalReduction::scanSkippedBody(
+    FunctionDecl *FD, llvm::StringMap<std::vector<unsigned>> &globals) {
+  SourceLocation declEnd = SrcManager->getExpansionLoc(FD->getLocEnd());
+  if (!SrcManager->isInMainFile(declEnd))
+    return;
+  FileID MainFileID = SrcManager->getMainFileID();
+  StringRef Buffer = SrcManager->getBufferData(MainFileID);
+  Lexer Lex(SrcManager->getLocForStartOfFile(MainFileID),
+            Context->getLangOpts(), Buffer.begin(),
+            Buffer.begin() + SrcManager->getFileOffset(declEnd), Buffer.end());
+
+  // from the first '{' after the declarator to its matching '}'
+  int depth = 0;
+  Token Tok;
+  while (true) {
+    Lex.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      return;
+    if (Tok.is(tok::l_brace)) {
+      depth++;
+    } else if (Tok.is(tok::r_brace) && depth > 0) {
+      if (--depth == 0)
+        break;
+    } else if (Tok.is(tok::raw_identifier) && depth > 0) {
+      auto global = globals.find(Tok.getRawIdentifier());
+      if (global != globals.end())
+        for (auto const &id : global->second)
+          LexicalRefs[id]++;
     }
-    totalEnd = end;
   }
-  revert = getSourceText(SourceRange(totalStart, totalEnd));
-
-  TheRewriter.ReplaceText(SourceRange(totalStart, totalEnd),
-                          StringUtils::placeholder(revert));
-  Transformation::writeToFile(Option::inputFile);
-
-  if (Transformation::callOracle("global")) {
-    /*// remove from refList and whereUsed
-    for (auto const &d : toBeRemoved) {
-      for (auto entry : refList) {
-        llvm::outs() << " in ref list ... \n";
-        if (entry.first == d)
-          continue;
-        llvm::outs() << "==== D:";
-        d->dump();
-        std::vector<DeclRefExpr*> tempRefs = std::move(entry.second);
-        llvm::outs() << entry.second.size() << "\n";
-        for (auto ref : entry.second) {
-          llvm::outs() << "***** compare against: ";
-          whereUsed[ref]->dump();
-          if (whereUsed[ref] == d) {
-            tempRefs.erase(std::remove(tempRefs.begin(), tempRefs.end(), ref), tempRefs.end()); 
-            llvm::outs() << "erased\n";
-          }
-        }
-        refList.insert(std::make_pair(d, tempRefs));
-      }
-    }*/
-    return true;
+  auto id = DeclIds.find(FD);
+  if (id != DeclIds.end())
+    BodyEnds[id->second] = Tok.getLocation();
+}
+
+SourceRange GlobalReduction::getRemovalRange(unsigned id) {
+  Decl *D = decls[id];
+  SourceLocation start = D->getSourceRange().getBegin();
+  SourceLocation end;
+
+  FunctionDecl *FD = dyn_cast<FunctionDecl>(D);
+  if (BodyEnds[id].isValid()) {
+    end = BodyEnds[id].getLocWithOffset(1);
+  } else if (FD && FD->isThisDeclarationADefinition()) {
+    end = FD->getSourceRange().getEnd().getLocWithOffset(1);
   } else {
-    // revert
-    TheRewriter.ReplaceText(SourceRange(totalStart, totalEnd), revert);
+    end = RewriteHelper->getEndLocationUntil(D->getSourceRange(), ';')
+              .getLocWithOffset(1);
+  }
+  return SourceRange(start, end);
+}
+
+void GlobalReduction::buildElementTable(void) {
+  Span span("candidates", "collect");
+  Table.clear();
+  Elements.clear();
+  for (unsigned i = 0; i < decls.size(); i++) {
+    Range range;
+    if (!getByteRange(getRemovalRange(i), range))
+      continue;
+    Table.add(decls[i]->getDeclKindName(), range.first, range.second, -1,
+              References[i] + LexicalRefs[i]);
+    Elements.emplace_back(decls[i]);
+  }
+}
+
+std::string GlobalReduction::getFingerprint(unsigned id,
+                                            const std::string &text) {
+  Decl *D = Elements[id];
+  std::string function = "";
+  unsigned offset = Table.Begins[id];
+  Range FR;
+  if (FunctionDecl *FD =
+          dyn_cast_or_null<FunctionDecl>(D->getParentFunctionOrMethod())) {
+    function = FD->getNameAsString();
+    if (getByteRange(FD->getSourceRange(), FR) && FR.first <= offset)
+      offset -= FR.first;
+  }
+  return ElementMemo::fingerprint(Table.Kinds[id], function, offset, text);
+}
+
+bool GlobalReduction::isKnownEssential(std::vector<unsigned> &subset) {
+  if (!Option::memoize || subset.size() != 1)
+    return false;
+  unsigned id = subset.front();
+  // only a lookahead: the memo hit is counted when the subset is reached
+  return ElementMemo::isKnownEssential(
+      getFingerprint(id, getRewrittenText(Table.getRange(id))));
+}
+
+bool GlobalReduction::test(std::vector<unsigned> &toBeRemoved,
+                           std::vector<unsigned> *next) {
+  // every element is blanked on its own so that whatever lies between them
+  // (e.g. main) stays
+  std::vector<Range> ranges = Table.getRanges(toBeRemoved);
+  bool staged = !StagedElements.empty() && StagedElements == toBeRemoved;
+  StagedElements.clear();
+  if (ranges.empty()) {
+    if (staged)
+      Transformation::writeToFile(Option::inputFile);
+    return false;
+  }
+
+  SourceVersion before = Source;
+  Source = Source.blank(ranges);
+  if (!staged)
     Transformation::writeToFile(Option::inputFile);
+
+  std::future<bool> oracle = std::async(
+      std::launch::async, [this] { return callOracle("global"); });
+
+  // assume a rejection, the common case, and stage the next candidate; it
+  // derives from the version before this one, which the oracle never touches
+  std::string staging = Option::outputDir + "/" + StagingFileName;
+  if (next) {
+    Span span("write", "write", "staged");
+    before.blank(Table.getRanges(*next)).writeToFile(staging);
+  }
+
+  if (oracle.get()) {
+    if (next)
+      std::remove(staging.c_str());
+    return true;
+  } else {
+    Span span("revert", "revert");
+    Source = before;
+    if (next && std::rename(staging.c_str(), Option::inputFile.c_str()) == 0)
+      StagedElements = *next;
+    else
+      Transformation::writeToFile(Option::inputFile);
     return false;
   }
 }
 
-std::vector<std::vector<clang::Decl *>> GlobalReduction::refineSubsets(
-    std::vector<std::vector<clang::Decl *>> &subsets) {
-  std::vector<std::vector<clang::Decl *>> result;
+std::vector<std::vector<unsigned>>
+GlobalReduction::refineSubsets(std::vector<std::vector<unsigned>> &subsets) {
+  std::vector<std::vector<unsigned>> result;
   for (auto const &subset : subsets) {
     bool flag = true;
     for (auto const &i : subset) {
-      if (refList[i].size() != 0) {
+      if (Table.Dependencies[i] != 0) {
         flag = false;
         break;
       }
@@ -205,39 +305,78 @@ std::vector<std::vector<clang::Decl *>> GlobalReduction::refineSubsets(
   return result;
 }
 
-void GlobalReduction::ddmin(std::vector<clang::Decl *> &decls) {
-  std::vector<Decl *> decls_;
-  decls_ = std::move(decls);
+void GlobalReduction::ddmin(void) {
+  std::vector<unsigned> elements;
+  for (unsigned i = 0; i < Table.size(); i++)
+    elements.emplace_back(i);
+
+  // weigh every element by the bytes it covers and try the large ones first
+  std::map<unsigned, unsigned> weights;
+  for (auto const &i : elements)
+    weights[i] = std::max(Table.Sizes[i], 1u);
+  VectorUtils::sortByWeight<unsigned>(elements, weights);
+
   int n = 2;
-  while (decls_.size() >= 1) {
-    std::vector<std::vector<clang::Decl *>> subsets =
-        VectorUtils::split<clang::Decl *>(decls_, n);
+  while (elements.size() >= 1 && !Budget::expired()) {
+    std::vector<std::vector<unsigned>> subsets =
+        VectorUtils::splitByWeight<unsigned>(elements, n, weights);
     bool complementSucceeding = false;
 
     auto refinedSubsets = refineSubsets(subsets);
-
-    for (auto subset : refinedSubsets) {
-      std::vector<Decl *> complement =
-          VectorUtils::difference<clang::Decl *>(decls_, subset);
-      bool status = test(subset);
+    Status::startRound(elements.size(), refinedSubsets.size());
+
+    for (int i = 0; i < refinedSubsets.size(); i++) {
+      Status::nextCandidate();
+      std::vector<unsigned> &subset = refinedSubsets[i];
+      std::vector<unsigned> *next = NULL;
+      for (int j = i + 1; j < refinedSubsets.size() && !next; j++)
+        if (!isKnownEssential(refinedSubsets[j]))
+          next = &refinedSubsets[j];
+      std::vector<unsigned> complement =
+          VectorUtils::difference<unsigned>(elements, subset);
+      std::vector<std::string> texts;
+      std::string fp;
+      if (Option::memoize) {
+        for (auto const &id : subset)
+          texts.emplace_back(getRewrittenText(Table.getRange(id)));
+        if (subset.size() == 1) {
+          fp = getFingerprint(subset.front(), texts.front());
+          if (ElementMemo::isEssential(fp))
+            continue;
+        }
+      }
+      bool status = test(subset, next);
       if (status) {
-        decls_ = std::move(complement);
+        for (auto const &text : texts)
+          ElementMemo::markRemoved(text);
+        elements = std::move(complement);
         n = std::max(n - 1, 2);
         complementSucceeding = true;
         break;
+      } else if (!fp.empty()) {
+        ElementMemo::markEssential(fp, texts.front());
       }
     }
 
     if (!complementSucceeding) {
-      if (n == decls_.size()) {
+      if (n == elements.size()) {
         break;
       }
 
-      n = std::min(n * 2, static_cast<int>(decls_.size()));
+      n = std::min(n * 2, static_cast<int>(elements.size()));
     }
   }
+
+  // a candidate staged for a test that never came
+  if (!StagedElements.empty()) {
+    StagedElements.clear();
+    Transformation::writeToFile(Option::inputFile);
+  }
 }
 
-void GlobalReduction::globalReduction(void) { ddmin(decls); }
+void GlobalReduction::globalReduction(void) {
+  buildElementTable();
+  ddmin();
+}
 
 GlobalReduction::~GlobalReduction(void) { delete CollectionVisitor; }
@@ -0,0 +1,197 @@
+#include "LineReduction.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "Budget.h"
+#include "EventLog.h"
+#include "Options.h"
+#include "Oracle.h"
+#include "StringUtils.h"
+#include "Report.h"
+#include "Stats.h"
+#include "Status.h"
+
+std::vector<LineReduction::Boundary>
+LineReduction::scan(const std::vector<std::string> &lines) {
+  std::vector<Boundary> boundaries;
+  boundaries.reserve(lines.size() + 1);
+  int brace = 0, cond = 0;
+  bool comment = false, continued = false;
+  for (auto const &line : lines) {
+    boundaries.push_back({brace, cond, !comment && !continued});
+
+    size_t first = line.find_first_not_of(" \t");
+    if (!comment && !continued && first != std::string::npos &&
+        line[first] == '#') {
+      size_t begin = line.find_first_not_of(" \t", first + 1);
+      if (begin != std::string::npos) {
+        if (line.compare(begin, 2, "if") == 0)
+          cond++;
+        else if (line.compare(begin, 5, "endif") == 0)
+          cond--;
+      }
+    }
+
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+      char c = line[i];
+      if (comment) {
+        if (c == '*' && i + 1 < line.size() && line[i + 1] == '/') {
+          comment = false;
+          i++;
+        }
+      } else if (quote) {
+        if (c == '\\')
+          i++;
+        else if (c == quote)
+          quote = 0;
+      } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/') {
+        break;
+      } else if (c == '/' && i + 1 < line.size() && line[i + 1] == '*') {
+        comment = true;
+        i++;
+      } else if (c == '"' || c == '\'') {
+        quote = c;
+      } else if (c == '{' || c == '(' || c == '[') {
+        brace++;
+      } else if (c == '}' || c == ')' || c == ']') {
+        brace--;
+      }
+    }
+    continued = !line.empty() && line.back() == '\\';
+  }
+  boundaries.push_back({brace, cond, !comment && !continued});
+  return boundaries;
+}
+
+bool LineReduction::isBalanced(const std::vector<Boundary> &boundaries,
+                               int begin, int end) {
+  const Boundary &b = boundaries[begin], &e = boundaries[end];
+  if (!b.cut || !e.cut || b.brace != e.brace || b.cond != e.cond)
+    return false;
+  for (int i = begin + 1; i < end; i++)
+    if (boundaries[i].brace < b.brace || boundaries[i].cond < b.cond)
+      return false;
+  return true;
+}
+
+bool LineReduction::isBlank(const std::vector<std::string> &lines, int begin,
+                            int end) {
+  for (int i = begin; i < end; i++)
+    if (lines[i].find_first_not_of(" \t\r") != std::string::npos)
+      return false;
+  return true;
+}
+
+// written aside and renamed, so that an interrupted run never leaves half a
+// file behind
+void LineReduction::write(const std::string &srcPath,
+                          const std::vector<std::string> &lines, int begin,
+                          int end) {
+  std::string temp = srcPath + ".tmp";
+  std::ofstream ofs(temp);
+  for (int i = 0; i < static_cast<int>(lines.size()); i++)
+    if (i < begin || i >= end)
+      ofs << lines[i] << '\n';
+  ofs.close();
+  if (ofs)
+    std::rename(temp.c_str(), srcPath.c_str());
+}
+
+bool LineReduction::test(const std::string &srcPath,
+                         const std::vector<std::string> &lines, int begin,
+                         int end) {
+  if (Budget::expired())
+    return false;
+  write(srcPath, lines, begin, end);
+  Report::lineCallsCounter.increment();
+  Report::callsByKind["line"].increment();
+  Status::countCalls(1, 0);
+  Report::oracleProfiler.startTimer();
+  Report::oracleProfilerByKind["line"].startTimer();
+  int status;
+  {
+    Span span("oracle", "oracle", "line");
+    double cpu = EventLog::getChildrenCPUTime();
+    long long start = Trace::now();
+    status = Oracle::run();
+    double wall = (Trace::now() - start) / 1e9;
+    Report::oracleTimes.emplace_back(wall);
+    if (EventLog::isOpen()) {
+      EventLog::Record record;
+      record.phase = record.kind = "line";
+      record.hash = StringUtils::hash(NULL, 0);
+      for (int i = 0; i < static_cast<int>(lines.size()); i++) {
+        unsigned long size = lines[i].size() + 1;
+        if (i < begin || i >= end) {
+          record.size += size;
+          record.hash = StringUtils::hash(lines[i].data(), lines[i].size(),
+                                          record.hash);
+          record.hash = StringUtils::hash("\n", 1, record.hash);
+        } else {
+          record.removed += size;
+        }
+      }
+      record.verdict = status == 0;
+      record.wall = wall;
+      record.cpu = EventLog::getChildrenCPUTime() - cpu;
+      record.exitCode = EventLog::getExitCode(status);
+      EventLog::record(record);
+    }
+  }
+  Report::oracleProfilerByKind["line"].stopTimer();
+  Report::oracleProfiler.stopTimer();
+  if (status == 0) {
+    Report::successfulLineCallsCounter.increment();
+    Report::successfulCallsByKind["line"].increment();
+    Status::countCalls(0, 1);
+    if (Budget::isLimited())
+      write(Option::outputFile, lines, begin, end);
+    return true;
+  }
+  // put the input back, so that an interrupted prepass leaves a valid file
+  write(srcPath, lines, 0, 0);
+  return false;
+}
+
+void LineReduction::reduce(const std::string &srcPath) {
+  std::vector<std::string> lines;
+  std::ifstream ifs(srcPath);
+  std::string line;
+  while (std::getline(ifs, line))
+    lines.emplace_back(line);
+  ifs.close();
+
+  // halve the chunk size down to single lines, C-Reduce style
+  for (int chunk = lines.size() / 2; chunk >= 1 && !Budget::expired();
+       chunk /= 2) {
+    if (Option::verbose)
+      std::cout << "line-prepass: chunk size " << chunk << std::endl;
+    std::vector<Boundary> boundaries = scan(lines);
+    Status::startRound(lines.size(), (lines.size() + chunk - 1) / chunk);
+    int begin = 0;
+    while (begin < static_cast<int>(lines.size())) {
+      int end = std::min(begin + chunk, static_cast<int>(lines.size()));
+      Status::nextCandidate();
+      if (!isBlank(lines, begin, end) && isBalanced(boundaries, begin, end) &&
+          test(srcPath, lines, begin, end)) {
+        lines.erase(lines.begin() + begin, lines.begin() + end);
+        unsigned long size = 0;
+        for (auto const &line : lines)
+          size += Stats::getByteCount(line);
+        Status::setSize(size);
+        // the scan is in the same state at begin and end, so the boundaries
+        // after the chunk stay as they are
+        boundaries.erase(boundaries.begin() + begin,
+                         boundaries.begin() + end);
+      } else {
+        begin = end;
+      }
+    }
+  }
+  write(srcPath, lines, 0, 0);
+}
@@ -3,15 +3,26 @@
 #include "clang/Basic/SourceManager.h"
 #include "clang/Lex/Lexer.h"
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <cctype>
+#include <fstream>
+#include <map>
 #include <sstream>
 
+#include "Budget.h"
 #include "CommonStatementVisitor.h"
+#include "ElementMemo.h"
+#include "EventLog.h"
 #include "LocalReduction.h"
 #include "Options.h"
+#include "Profiling.h"
 #include "Report.h"
 #include "RewriteUtils.h"
+#include "Sandbox.h"
+#include "Status.h"
 #include "StringUtils.h"
 #include "TransformationManager.h"
 #include "VectorUtils.h"
@@ -20,6 +31,8 @@ using namespace clang;
 
 static const char *DescriptionMsg = "Perform local-level reduction";
 
+static const char *EditsFileName = "chisel-edits";
+
 class LocalReductionCollectionVisitor
     : public RecursiveASTVisitor<LocalReductionCollectionVisitor> {
 public:
@@ -40,13 +53,20 @@ bool LocalReductionCollectionVisitor::VisitFunctionDecl(FunctionDecl *FD) {
     llvm::outs() << "function decl " << FD->getNameInfo().getAsString() << "\n";
   if (FD->isThisDeclarationADefinition()) {
     ConsumerInstance->functionBodies.emplace_back(FD->getBody());
+    ConsumerInstance->functionNames.emplace_back(
+        FD->getNameInfo().getAsString());
   }
   return true;
 }
 
 void LocalReduction::Initialize(ASTContext &context) {
   Transformation::Initialize(context);
-  CollectionVisitor = new LocalReductionCollectionVisitor(this);
+  functionBodies.clear();
+  functionNames.clear();
+  Table.clear();
+  ElementIds.clear();
+  if (!CollectionVisitor)
+    CollectionVisitor = new LocalReductionCollectionVisitor(this);
 }
 
 bool LocalReduction::HandleTopLevelDecl(DeclGroupRef D) {
@@ -57,86 +77,122 @@ bool LocalReduction::HandleTopLevelDecl(DeclGroupRef D) {
 }
 
 void LocalReduction::HandleTranslationUnit(ASTContext &Ctx) {
+  endParse();
   localReduction();
 }
 
-bool LocalReduction::test(std::vector<clang::Stmt *> &toBeRemoved) {
-  const SourceManager *SM = &Context->getSourceManager();
-  SourceLocation totalStart, totalEnd;
-  totalStart = toBeRemoved.front()->getSourceRange().getBegin();
-  Stmt *last = toBeRemoved.back();
-
-  if (CompoundStmt *CS = dyn_cast<CompoundStmt>(last)) {
-    totalEnd = CS->getRBracLoc().getLocWithOffset(1);
-  } else if (IfStmt *IS = dyn_cast<IfStmt>(last)) {
-    totalEnd = last->getSourceRange().getEnd().getLocWithOffset(1);
-  } else if (WhileStmt *WS = dyn_cast<WhileStmt>(last)) {
-    totalEnd = last->getSourceRange().getEnd().getLocWithOffset(1);
-  } else if (LabelStmt *LS = dyn_cast<LabelStmt>(last)) {
-    auto subStmt = LS->getSubStmt();
-    if (CompoundStmt *LS_CS = dyn_cast<CompoundStmt>(subStmt)) {
-      totalEnd = LS_CS->getRBracLoc().getLocWithOffset(1);
-    } else {
-      totalEnd =
-          RewriteHelper->getEndLocationUntil(subStmt->getSourceRange(), ';')
-              .getLocWithOffset(1);
-    }
-  } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(last)) {
-    totalEnd = RewriteHelper->getEndLocationAfter(last->getSourceRange(), ';');
-  } else if (ReturnStmt *RS = dyn_cast<ReturnStmt>(last)) {
-    totalEnd = RewriteHelper->getEndLocationAfter(RS->getSourceRange(), ';');
-  } else if (GotoStmt *GS = dyn_cast<GotoStmt>(last)) {
-    totalEnd = RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
-                   .getLocWithOffset(1);
-  } else if (BreakStmt *BS = dyn_cast<BreakStmt>(last)) {
-    totalEnd = RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
-                   .getLocWithOffset(1);
-  } else if (ContinueStmt *CS = dyn_cast<ContinueStmt>(last)) {
-    totalEnd = RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
-                   .getLocWithOffset(1);
-  } else if (DeclStmt *DS = dyn_cast<DeclStmt>(last)) {
-    totalEnd = RewriteHelper->getEndLocationAfter(last->getSourceRange(), ';');
-  } else if (CallExpr *CE = dyn_cast<CallExpr>(last)) {
-    totalEnd = RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
-                   .getLocWithOffset(1);
-  } else if (UnaryOperator *UO = dyn_cast<UnaryOperator>(last)) {
-    totalEnd = RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
-                   .getLocWithOffset(1);
-  } else {
-    return false;
+int LocalReduction::getElement(Stmt *s) {
+  auto found = ElementIds.find(s);
+  if (found != ElementIds.end())
+    return found->second;
+  int id = -1;
+  Range range;
+  if (getByteRange(SourceRange(s->getLocStart(), getEndLocation(s)), range)) {
+    int parent = -1;
+    Stmt *body = functionBodies[CurrentFunction];
+    if (s != body)
+      parent = getElement(body);
+    id = Table.add(s->getStmtClassName(), range.first, range.second, parent);
   }
+  ElementIds[s] = id;
+  return id;
+}
 
-  if (totalEnd.isInvalid() || totalStart.isInvalid())
+bool LocalReduction::getRange(Stmt *first, Stmt *last, Range &range) {
+  int begin = getElement(first), end = getElement(last);
+  if (begin < 0 || end < 0 || Table.Ends[end] < Table.Begins[begin])
     return false;
+  range = Range(Table.Begins[begin], Table.Ends[end]);
+  return true;
+}
+
+std::string LocalReduction::getElementText(Stmt *first, Stmt *last) {
+  Range range;
+  if (!getRange(first, last, range))
+    return "";
+  return getRewrittenText(range);
+}
 
-  std::string revert =
-      Transformation::getSourceText(SourceRange(totalStart, totalEnd));
-  TheRewriter.ReplaceText(SourceRange(totalStart, totalEnd),
-                          StringUtils::placeholder(revert));
+bool LocalReduction::test(std::vector<clang::Stmt *> &toBeRemoved) {
+  Range range;
+  if (!getRange(toBeRemoved.front(), toBeRemoved.back(), range))
+    return false;
+
+  SourceVersion before = Source;
+  Source = Source.blank(range);
   Transformation::writeToFile(Option::inputFile);
 
   if (Transformation::callOracle("local")) {
     return true;
   } else {
-    TheRewriter.ReplaceText(SourceRange(totalStart, totalEnd), revert);
-    Transformation::writeToFile(Option::inputFile);
+    revert(before);
     return false;
   }
 }
 
+int LocalReduction::testSpeculatively(
+    std::vector<std::vector<SourceRange>> &candidates, std::string msg) {
+  std::vector<SourceVersion> versions;
+  for (auto const &candidate : candidates) {
+    std::vector<Range> ranges;
+    if (!getByteRanges(candidate, ranges))
+      return -1;
+    versions.emplace_back(Source.blank(ranges));
+  }
+
+  std::vector<bool> results = Transformation::callOracles(versions, msg);
+  for (int i = 0; i < results.size(); i++) {
+    if (results[i]) {
+      Source = versions[i];
+      Transformation::writeToFile(Option::inputFile);
+      saveBest();
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool LocalReduction::testMemoized(std::vector<clang::Stmt *> &toBeRemoved) {
+  if (!Option::memoize)
+    return test(toBeRemoved);
+
+  std::string text = getElementText(toBeRemoved.front(), toBeRemoved.back());
+  std::string fp;
+  if (toBeRemoved.size() == 1) {
+    int id = getElement(toBeRemoved.front());
+    int body = getElement(functionBodies[CurrentFunction]);
+    unsigned offset = id < 0 ? 0 : Table.Begins[id];
+    if (id >= 0 && body >= 0)
+      offset -= Table.Begins[body];
+    fp = ElementMemo::fingerprint(toBeRemoved.front()->getStmtClassName(),
+                                  CurrentFunctionName, offset, text);
+    if (ElementMemo::isEssential(fp))
+      return false;
+  }
+  if (test(toBeRemoved)) {
+    ElementMemo::markRemoved(text);
+    return true;
+  }
+  if (!fp.empty())
+    ElementMemo::markEssential(fp, text);
+  return false;
+}
+
 void LocalReduction::ddmin(std::vector<clang::Stmt *> stmts) {
   std::vector<Stmt *> stmts_;
   stmts_ = std::move(stmts);
   int n = 2;
-  while (stmts_.size() >= 1) {
+  while (stmts_.size() >= 1 && !Budget::expired()) {
     std::vector<std::vector<clang::Stmt *>> subsets =
         VectorUtils::split<clang::Stmt *>(stmts_, n);
     bool complementSucceeding = false;
+    Status::startRound(stmts_.size(), subsets.size());
 
     for (std::vector<Stmt *> &subset : subsets) {
+      Status::nextCandidate();
       std::vector<Stmt *> complement =
           VectorUtils::difference<clang::Stmt *>(stmts_, subset);
-      bool status = test(subset);
+      bool status = testMemoized(subset);
       if (status) {
         stmts_ = std::move(complement);
         n = std::max(n - 1, 2);
@@ -199,53 +255,66 @@ void LocalReduction::reduceIf(IfStmt *IS) {
       endThen.isInvalid())
     return;
 
-  std::string revertIf =
-      Transformation::getSourceText(SourceRange(beginIf, endIf));
+  if (Option::jobs > 1 && Sandbox::isSupported()) {
+    // evaluate the whole-if, else and then removals at once; the first
+    // success in that order wins
+    std::vector<std::vector<SourceRange>> candidates;
+    candidates.push_back({SourceRange(beginIf, endIf)});
+    if (Else) {
+      candidates.push_back(
+          {SourceRange(beginIf, endCond), SourceRange(elseLoc, endIf)});
+      candidates.push_back(
+          {SourceRange(beginIf, elseLoc.getLocWithOffset(4))});
+    } else {
+      candidates.push_back({SourceRange(beginIf, endCond)});
+    }
+    int chosen = testSpeculatively(candidates, "if");
+    if (chosen == 0)
+      return;
+    if (chosen != 2)
+      push(Then);
+    if (Else && chosen != 1)
+      push(ElseAsCompoundStmt);
+    return;
+  }
+
+  Range cond;
+  if (!getByteRange(SourceRange(beginIf, endCond), cond))
+    return;
+  SourceVersion before = Source;
 
   if (Else) { // then, else
     // remove else branch
-    std::string ifAndCond =
-        Transformation::getSourceText(SourceRange(beginIf, endCond));
-    TheRewriter.ReplaceText(SourceRange(beginIf, endCond),
-                            StringUtils::placeholder(ifAndCond));
-    std::string elsePart =
-        Transformation::getSourceText(SourceRange(elseLoc, endIf));
-    TheRewriter.ReplaceText(SourceRange(elseLoc, endIf),
-                            StringUtils::placeholder(elsePart));
+    Range elsePart, ifAndThenAndElseWord;
+    if (!getByteRange(SourceRange(elseLoc, endIf), elsePart) ||
+        !getByteRange(SourceRange(beginIf, elseLoc.getLocWithOffset(4)),
+                      ifAndThenAndElseWord))
+      return;
+    Source = before.blank({cond, elsePart});
     Transformation::writeToFile(Option::inputFile);
     if (Transformation::callOracle("if")) { // successfully remove else branch
-      q.push(Then);
-    } else { // revert else branch removal
-      TheRewriter.ReplaceText(SourceRange(beginIf, endIf), revertIf);
-      Transformation::writeToFile(Option::inputFile);
+      push(Then);
+    } else {
       // remove then branch
-      std::string ifAndThenAndElseWord = Transformation::getSourceText(
-          SourceRange(beginIf, elseLoc.getLocWithOffset(4)));
-      TheRewriter.ReplaceText(SourceRange(beginIf, elseLoc.getLocWithOffset(4)),
-                              StringUtils::placeholder(ifAndThenAndElseWord));
+      Source = before.blank(ifAndThenAndElseWord);
       Transformation::writeToFile(Option::inputFile);
       if (Transformation::callOracle("if")) { // successfully remove then branch
-        q.push(ElseAsCompoundStmt);
+        push(ElseAsCompoundStmt);
       } else { // revert then branch removal
-        TheRewriter.ReplaceText(SourceRange(beginIf, endIf), revertIf);
-        Transformation::writeToFile(Option::inputFile);
-        q.push(Then);
-        q.push(ElseAsCompoundStmt);
+        revert(before);
+        push(Then);
+        push(ElseAsCompoundStmt);
       }
     }
   } else { // then
     // remove condition
-    std::string ifAndCond =
-        Transformation::getSourceText(SourceRange(beginIf, endCond));
-    TheRewriter.ReplaceText(SourceRange(beginIf, endCond),
-                            StringUtils::placeholder(ifAndCond));
+    Source = before.blank(cond);
     Transformation::writeToFile(Option::inputFile);
     if (Transformation::callOracle("if")) {
-      q.push(Then);
+      push(Then);
     } else {
-      TheRewriter.ReplaceText(SourceRange(beginIf, endIf), revertIf);
-      Transformation::writeToFile(Option::inputFile);
-      q.push(Then);
+      revert(before);
+      push(Then);
     }
   }
 }
@@ -257,41 +326,163 @@ void LocalReduction::reduceWhile(WhileStmt *WS) {
   SourceLocation endCond =
       body->getSourceRange().getBegin().getLocWithOffset(-1);
 
-  std::string revertWhile =
-      Transformation::getSourceText(SourceRange(beginWhile, endWhile));
-
-  std::string whileAndCond =
-      Transformation::getSourceText(SourceRange(beginWhile, endCond));
-  TheRewriter.ReplaceText(SourceRange(beginWhile, endCond),
-                          StringUtils::placeholder(whileAndCond));
+  Range whileAndCond;
+  if (!getByteRange(SourceRange(beginWhile, endCond), whileAndCond))
+    return;
+  SourceVersion before = Source;
+  Source = before.blank(whileAndCond);
   Transformation::writeToFile(Option::inputFile);
   if (Transformation::callOracle("loop")) {
-    q.push(body);
+    push(body);
   } else {
     // revert
-    TheRewriter.ReplaceText(SourceRange(beginWhile, endWhile), revertWhile);
-    Transformation::writeToFile(Option::inputFile);
-    q.push(body);
+    revert(before);
+    push(body);
   }
 }
 
 void LocalReduction::reduceCompound(CompoundStmt *CS) {
   auto stmts = getBodyStatements(CS);
   for (auto stmt : stmts)
-    q.push(stmt);
+    push(stmt);
   ddmin(stmts);
 }
 
 void LocalReduction::reduceLabel(LabelStmt *LS) {
   if (CompoundStmt *CS = dyn_cast<CompoundStmt>(LS->getSubStmt())) {
-    q.push(CS);
+    push(CS);
   }
 }
 
+void LocalReduction::reduceFor(ForStmt *FS) {
+  std::vector<Stmt *> whole = {FS};
+  if (testMemoized(whole))
+    return;
+
+  // remove the header so that the body runs once
+  auto body = FS->getBody();
+  SourceLocation beginFor = FS->getForLoc();
+  SourceLocation endHeader =
+      body->getSourceRange().getBegin().getLocWithOffset(-1);
+  Range header;
+  if (getByteRange(SourceRange(beginFor, endHeader), header)) {
+    SourceVersion before = Source;
+    Source = before.blank(header);
+    Transformation::writeToFile(Option::inputFile);
+    if (!Transformation::callOracle("loop")) {
+      revert(before);
+    }
+  }
+  push(body);
+}
+
+void LocalReduction::reduceDo(DoStmt *DS) {
+  std::vector<Stmt *> whole = {DS};
+  if (testMemoized(whole))
+    return;
+
+  // remove "do" and "while (cond);" so that the body runs once
+  auto body = DS->getBody();
+  SourceLocation doLoc = DS->getDoLoc();
+  SourceLocation whileLoc = DS->getWhileLoc();
+  SourceLocation endDo = RewriteHelper->getLocationUntil(DS->getRParenLoc(), ';');
+  std::vector<Range> doAndWhile;
+  if (getByteRanges({SourceRange(doLoc, doLoc), SourceRange(whileLoc, endDo)},
+                    doAndWhile)) {
+    SourceVersion before = Source;
+    Source = before.blank(doAndWhile);
+    Transformation::writeToFile(Option::inputFile);
+    if (!Transformation::callOracle("loop")) {
+      revert(before);
+    }
+  }
+  push(body);
+}
+
+void LocalReduction::reduceSwitch(SwitchStmt *SS) {
+  std::vector<Stmt *> whole = {SS};
+  if (testMemoized(whole))
+    return;
+
+  CompoundStmt *CS = dyn_cast<CompoundStmt>(SS->getBody());
+  if (!CS) {
+    push(SS->getBody());
+    return;
+  }
+
+  // a case is its label together with the statements up to the next label
+  std::vector<std::vector<Stmt *>> cases;
+  for (auto stmt : getBodyStatements(CS)) {
+    if (isa<SwitchCase>(stmt))
+      cases.emplace_back(std::vector<Stmt *>{stmt});
+    else if (!cases.empty())
+      cases.back().emplace_back(stmt);
+  }
+
+  // then the statements of every case that is left, including the one under
+  // the (innermost) label, which the label stays in front of
+  for (auto const &c : ddminCases(cases)) {
+    Stmt *first = c.front();
+    while (SwitchCase *SC = dyn_cast_or_null<SwitchCase>(first))
+      first = SC->getSubStmt();
+    std::vector<Stmt *> stmts;
+    if (first)
+      stmts.emplace_back(first);
+    stmts.insert(stmts.end(), c.begin() + 1, c.end());
+    for (auto stmt : c)
+      push(stmt);
+    if (!stmts.empty())
+      ddmin(stmts);
+  }
+}
+
+void LocalReduction::reduceCase(SwitchCase *SC) { push(SC->getSubStmt()); }
+
+std::vector<std::vector<Stmt *>>
+LocalReduction::ddminCases(std::vector<std::vector<Stmt *>> cases) {
+  int n = 2;
+  while (cases.size() >= 1 && !Budget::expired()) {
+    std::vector<std::vector<std::vector<Stmt *>>> subsets =
+        VectorUtils::split<std::vector<Stmt *>>(cases, n);
+    bool complementSucceeding = false;
+    Status::startRound(cases.size(), subsets.size());
+
+    for (auto &subset : subsets) {
+      Status::nextCandidate();
+      std::vector<Stmt *> stmts;
+      for (auto const &c : subset)
+        stmts.insert(stmts.end(), c.begin(), c.end());
+      if (test(stmts)) {
+        cases = VectorUtils::difference<std::vector<Stmt *>>(cases, subset);
+        n = std::max(n - 1, 2);
+        complementSucceeding = true;
+        break;
+      }
+    }
+
+    if (!complementSucceeding) {
+      if (n == cases.size()) {
+        break;
+      }
+
+      n = std::min(n * 2, static_cast<int>(cases.size()));
+    }
+  }
+  return cases;
+}
+
 void LocalReduction::hdd(Stmt *s) {
   if (s == NULL)
     return;
 
+  // nothing left to reduce under a node an earlier candidate removed
+  std::string text = getElementText(s, s);
+  if (!text.empty() &&
+      text.find_first_not_of(" \t\r\n") == std::string::npos)
+    return;
+
+  Span span(s->getStmtClassName(), "hdd");
+  NodeKind = s->getStmtClassName();
   if (IfStmt *IS = dyn_cast<IfStmt>(s)) {
     if (Option::verbose)
       llvm::outs() << "hhd: if\n";
@@ -308,21 +499,191 @@ void LocalReduction::hdd(Stmt *s) {
     if (Option::verbose)
       llvm::outs() << "hdd: label\n";
     reduceLabel(LS);
+  } else if (ForStmt *FS = dyn_cast<ForStmt>(s)) {
+    if (Option::verbose)
+      llvm::outs() << "hdd: for\n";
+    reduceFor(FS);
+  } else if (DoStmt *DS = dyn_cast<DoStmt>(s)) {
+    if (Option::verbose)
+      llvm::outs() << "hdd: do\n";
+    reduceDo(DS);
+  } else if (SwitchStmt *SS = dyn_cast<SwitchStmt>(s)) {
+    if (Option::verbose)
+      llvm::outs() << "hdd: switch\n";
+    reduceSwitch(SS);
+  } else if (SwitchCase *SC = dyn_cast<SwitchCase>(s)) {
+    if (Option::verbose)
+      llvm::outs() << "hdd: case\n";
+    reduceCase(SC);
   } else {
     return;
-    // TODO add other cases: For, Do, Switch...
   }
 }
 
-void LocalReduction::localReduction(void) {
-  for (auto const &body : functionBodies) {
-    q.push(body);
-    while (!q.empty()) {
-      Stmt *s = q.front();
-      q.pop();
-      hdd(s);
+double LocalReduction::getPriority(Stmt *s) {
+  if (s == NULL || !Budget::isLimited())
+    return 0;
+  std::string kind = "local";
+  if (isa<IfStmt>(s))
+    kind = "if";
+  else if (isa<WhileStmt>(s) || isa<ForStmt>(s) || isa<DoStmt>(s))
+    kind = "loop";
+  int id = getElement(s);
+  if (id < 0)
+    return 0;
+  // expected bytes removed per expected oracle second
+  return Table.Sizes[id] * Report::getSuccessRate(kind) /
+         Report::getMeanOracleTime(kind);
+}
+
+void LocalReduction::push(Stmt *s) {
+  q.push({getPriority(s), pushed++, s, CurrentFunction});
+}
+
+void LocalReduction::drain(void) {
+  while (!q.empty() && !Budget::expired()) {
+    Pending p = q.top();
+    q.pop();
+    CurrentFunction = p.function;
+    CurrentFunctionName = functionNames[p.function];
+    hdd(p.stmt);
+  }
+}
+
+void LocalReduction::reduceFunction(int i) {
+  CurrentFunction = i;
+  push(functionBodies[i]);
+  drain();
+}
+
+void LocalReduction::reduceFunctionInSandbox(int i, const std::string &dir) {
+  if (!Sandbox::create(dir) || chdir(dir.c_str()) != 0)
+    _exit(1);
+  // the parent keeps the best result so far and owns the other workers
+  Option::outputFile = "";
+  Option::jobs = 1;
+  Transformation::writeToFile(Option::inputFile);
+
+  unsigned calls = Report::localCallsCounter.count();
+  unsigned successes = Report::successfulLocalCallsCounter.count();
+  std::string original = getRewrittenSource();
+  reduceFunction(i);
+  std::string reduced = getRewrittenSource();
+
+  // report the oracle calls, then the byte ranges this worker blanked
+  std::ofstream ofs(dir + "/" + EditsFileName);
+  ofs << Report::localCallsCounter.count() - calls << " "
+      << Report::successfulLocalCallsCounter.count() - successes << "\n";
+  for (unsigned b = 0; b < reduced.size(); b++) {
+    if (reduced[b] == original[b])
+      continue;
+    unsigned e = b;
+    while (e < reduced.size() && reduced[e] != original[e])
+      e++;
+    ofs << b << " " << e << "\n";
+    b = e;
+  }
+  ofs.close();
+  llvm::outs().flush();
+  EventLog::flush();
+  _exit(0);
+}
+
+std::vector<LocalReduction::Range>
+LocalReduction::readEdits(const std::string &dir) {
+  std::vector<Range> edits;
+  std::ifstream ifs(dir + "/" + EditsFileName);
+  unsigned calls, successes;
+  if (!(ifs >> calls >> successes))
+    return edits;
+  Report::localCallsCounter.add(calls);
+  Report::successfulLocalCallsCounter.add(successes);
+  Status::countCalls(calls, successes);
+  unsigned b, e;
+  while (ifs >> b >> e)
+    edits.emplace_back(Range(b, e));
+  return edits;
+}
+
+void LocalReduction::parallelLocalReduction(void) {
+  // every function is reduced by a forked worker with its own copy of the
+  // AST and buffer, in its own sandbox
+  std::vector<std::vector<Range>> edits(functionBodies.size());
+  std::map<pid_t, int> running;
+  int next = 0;
+  llvm::outs().flush();
+  while (next < functionBodies.size() || !running.empty()) {
+    while (running.size() < Option::jobs && next < functionBodies.size()) {
+      std::string dir = Sandbox::getPath(next);
+      EventLog::flush();
+      pid_t pid = fork();
+      if (pid == 0)
+        reduceFunctionInSandbox(next, dir);
+      if (pid < 0)
+        break;
+      running[pid] = next++;
     }
+    if (running.empty()) { // cannot fork; reduce the rest here
+      reduceFunction(next++);
+      continue;
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+      break;
+    int i = running[pid];
+    running.erase(pid);
+    std::string dir = Sandbox::getPath(i);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+      edits[i] = readEdits(dir);
+    Sandbox::remove(dir);
+  }
+
+  std::vector<int> pending;
+  for (int i = 0; i < edits.size(); i++)
+    if (!edits[i].empty())
+      pending.emplace_back(i);
+  if (!pending.empty())
+    mergeEdits(edits, pending);
+}
+
+void LocalReduction::mergeEdits(std::vector<std::vector<Range>> &edits,
+                                std::vector<int> functions) {
+  // the edits of different functions are disjoint; confirm them together and
+  // bisect on conflict
+  SourceVersion before = Source;
+  for (auto i : functions)
+    Source = Source.blank(edits[i]);
+  Transformation::writeToFile(Option::inputFile);
+  if (Transformation::callOracle("local"))
+    return;
+
+  revert(before);
+  if (functions.size() == 1)
+    return;
+
+  std::vector<std::vector<int>> halves = VectorUtils::split<int>(functions, 2);
+  mergeEdits(edits, halves[0]);
+  mergeEdits(edits, halves[1]);
+}
+
+void LocalReduction::localReduction(void) {
+  if (Option::jobs > 1 && functionBodies.size() > 1 &&
+      Sandbox::isSupported()) {
+    parallelLocalReduction();
+    return;
+  }
+  if (Budget::isLimited()) {
+    // schedule the nodes of all functions together, best first
+    for (CurrentFunction = 0; CurrentFunction < functionBodies.size();
+         CurrentFunction++)
+      push(functionBodies[CurrentFunction]);
+    drain();
+    return;
   }
+  for (int i = 0; i < functionBodies.size(); i++)
+    reduceFunction(i);
 }
 
 LocalReduction::~LocalReduction(void) { delete CollectionVisitor; }
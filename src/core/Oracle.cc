@@ -0,0 +1,150 @@
+#include "Oracle.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "Options.h"
+#include "StringUtils.h"
+#include "TransformationManager.h"
+
+static const std::string BuiltinPrefix = "builtin:";
+
+std::unique_ptr<Oracle> Oracle::Instance;
+
+static std::string readFile(const std::string &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  return buffer.str();
+}
+
+bool Oracle::isBuiltin(const std::string &spec) {
+  return spec.compare(0, BuiltinPrefix.size(), BuiltinPrefix) == 0;
+}
+
+bool Oracle::setUp(const std::string &spec, std::string &error) {
+  if (!isBuiltin(spec)) {
+    Instance.reset(new ExternalOracle(spec));
+    return true;
+  }
+  Instance = create(spec.substr(BuiltinPrefix.size()), error);
+  return Instance != nullptr;
+}
+
+std::unique_ptr<Oracle> Oracle::use(std::unique_ptr<Oracle> oracle) {
+  std::swap(Instance, oracle);
+  return oracle;
+}
+
+Oracle *Oracle::get() {
+  if (!Instance)
+    Instance.reset(new ExternalOracle(Option::oracleFile));
+  return Instance.get();
+}
+
+int Oracle::run() {
+  Oracle *oracle = get();
+  if (oracle->isExternal())
+    return oracle->check("");
+  return oracle->check(readFile(Option::inputFile));
+}
+
+// SPEC+SPEC+...; pattern= takes the rest of the spec, since a regex may
+// contain '+'.
+std::unique_ptr<Oracle> Oracle::create(const std::string &spec,
+                                       std::string &error) {
+  std::unique_ptr<AllOracle> all(new AllOracle());
+  size_t begin = 0;
+  while (begin <= spec.size()) {
+    size_t end = spec.find('+', begin);
+    if (spec.compare(begin, 8, "pattern=") == 0 || end == std::string::npos)
+      end = spec.size();
+    std::string term = spec.substr(begin, end - begin);
+    std::string name = term.substr(0, term.find('='));
+    std::string arg =
+        name.size() < term.size() ? term.substr(name.size() + 1) : "";
+    begin = end + 1;
+
+    if (name == "parses") {
+      all->add(std::unique_ptr<Oracle>(new ParsesOracle(
+          TransformationManager::getNumParseErrors(
+              readFile(Option::inputFile)))));
+    } else if (name == "symbols" && !arg.empty()) {
+      all->add(std::unique_ptr<Oracle>(
+          new SymbolsOracle(StringUtils::splitBy(arg, ','))));
+    } else if (name == "pattern" && !arg.empty()) {
+      try {
+        all->add(std::unique_ptr<Oracle>(new PatternOracle(std::regex(arg))));
+      } catch (const std::regex_error &e) {
+        error = "invalid pattern " + arg;
+        return nullptr;
+      }
+    } else if (name == "random" && !arg.empty()) {
+      char *rest;
+      double probability = strtod(arg.c_str(), &rest);
+      unsigned long long seed = 0;
+      if (*rest == ',')
+        seed = strtoull(rest + 1, &rest, 10);
+      if (*rest != '\0' || probability < 0 || probability > 1) {
+        error = "invalid random oracle " + term;
+        return nullptr;
+      }
+      all->add(std::unique_ptr<Oracle>(new RandomOracle(probability, seed)));
+    } else {
+      error = "unknown builtin oracle " + term;
+      return nullptr;
+    }
+  }
+  return std::move(all);
+}
+
+int ExternalOracle::check(const std::string &program) {
+  return system(Command.c_str());
+}
+
+int ParsesOracle::check(const std::string &program) {
+  if (TransformationManager::getNumParseErrors(program) > BaseErrors)
+    return Rejected;
+  return 0;
+}
+
+static bool isIdentifierChar(char c) {
+  return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+int SymbolsOracle::check(const std::string &program) {
+  for (auto const &symbol : Symbols) {
+    bool found = false;
+    for (size_t pos = program.find(symbol);
+         pos != std::string::npos && !found;
+         pos = program.find(symbol, pos + 1))
+      found = (pos == 0 || !isIdentifierChar(program[pos - 1])) &&
+              (pos + symbol.size() == program.size() ||
+               !isIdentifierChar(program[pos + symbol.size()]));
+    if (!found)
+      return Rejected;
+  }
+  return 0;
+}
+
+int PatternOracle::check(const std::string &program) {
+  return std::regex_search(program, Pattern) ? 0 : Rejected;
+}
+
+int RandomOracle::check(const std::string &program) {
+  unsigned long long hash = StringUtils::hash(
+      program.data(), program.size(),
+      StringUtils::hash(reinterpret_cast<const char *>(&Seed), sizeof(Seed)));
+  return hash % 1000000 < Probability * 1000000 ? 0 : Rejected;
+}
+
+int AllOracle::check(const std::string &program) {
+  for (auto const &oracle : Oracles) {
+    int status = oracle->check(program);
+    if (status != 0)
+      return status;
+  }
+  return 0;
+}
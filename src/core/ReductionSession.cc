@@ -0,0 +1,310 @@
+#include "ReductionSession.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "Budget.h"
+#include "Coverage.h"
+#include "ElementMemo.h"
+#include "LineReduction.h"
+#include "Memory.h"
+#include "Options.h"
+#include "Oracle.h"
+#include "Report.h"
+#include "Sandbox.h"
+#include "Stats.h"
+#include "Status.h"
+#include "TransformationManager.h"
+
+static void runTransformation(const std::string &name) {
+  std::string ErrorMsg = "error";
+  int ErrorCode = -1;
+  TransformationManager *TransMgr = TransformationManager::GetInstance();
+  TransMgr->setTransformation(name);
+  TransMgr->initializeCompilerInstance(ErrorMsg);
+  TransMgr->doTransformation(ErrorMsg, ErrorCode);
+}
+
+// Under --max_rss, gives up the modes that hold extra memory first: the memo
+// and parallel oracles. Returns false once that was not enough, and the run
+// should stop building new ASTs.
+static bool withinMemoryLimit() {
+  static bool fellBack = false;
+  TransformationManager::GetInstance()->releaseCompilerInstance();
+  if (!Memory::exceeded())
+    return true;
+  if (fellBack)
+    return false;
+  std::cerr << "chisel: resident set above " << Option::maxRSS
+            << " MB, disabling the memo and parallel oracles" << std::endl;
+  Option::memoize = false;
+  Option::jobs = 1;
+  ElementMemo::clear();
+  fellBack = true;
+  return !Memory::exceeded();
+}
+
+void ReductionSession::reduceFile(Strategy strategy) {
+  if (Option::linePrepass || strategy == Lines) {
+    Status::setPhase("line-prepass");
+    LineReduction::reduce(Option::inputFile);
+  }
+  if (strategy == Lines)
+    return;
+
+  if (Option::coverage && Coverage::collect(Option::inputFile))
+    runTransformation("coverage-reduction");
+
+  int wc = 0, wc0 = 0;
+  for (int iteration = 1;; iteration++) {
+    Status::setIteration(iteration);
+    wc0 = Stats::getWordCount(Option::inputFile.c_str());
+
+    if (!Option::skipGlobal)
+      runTransformation("global-reduction");
+    if (!Option::skipLocal)
+      runTransformation("local-reduction");
+
+    wc = Stats::getWordCount(Option::inputFile.c_str());
+    if (wc == wc0 || strategy == SinglePass || Budget::expired() ||
+        !withinMemoryLimit())
+      break;
+  }
+
+  if (Option::tokenReduction && !Budget::expired() && withinMemoryLimit())
+    runTransformation("token-reduction");
+}
+
+static bool writeFile(const std::string &path, const std::string &text) {
+  std::ofstream ofs(path, std::ios::binary);
+  ofs << text;
+  return static_cast<bool>(ofs);
+}
+
+static std::string readFile(const std::string &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  return buffer.str();
+}
+
+static bool readAll(int fd, void *data, size_t size) {
+  char *p = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool writeAll(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+// Messages from the reducing child to the session, each a kind byte and a
+// length-prefixed text: a candidate for the callback, answered with one
+// verdict byte, or the stats once the run is over.
+static const char CheckMessage = 'C';
+static const char StatsMessage = 'S';
+
+static bool sendMessage(int fd, char kind, const std::string &text) {
+  unsigned long long size = text.size();
+  return writeAll(fd, &kind, 1) && writeAll(fd, &size, sizeof(size)) &&
+         writeAll(fd, text.data(), text.size());
+}
+
+static bool receiveMessage(int fd, char &kind, std::string &text) {
+  unsigned long long size;
+  if (!readAll(fd, &kind, 1) || !readAll(fd, &size, sizeof(size)))
+    return false;
+  text.resize(size);
+  return size == 0 || readAll(fd, &text[0], size);
+}
+
+static void setCloseOnExec(int fd) {
+  fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+// The child of a session: all of chisel's process-wide state, the working
+// directory included, is its own copy, so nothing of the calling process is
+// touched. Never returns.
+void ReductionSession::reduceInChild(const std::string &dir, int requests,
+                                     int replies) {
+  if (chdir(dir.c_str()) != 0)
+    _exit(1);
+  Option::inputFile = Name;
+  Option::outputFile = Name + ".chisel.c";
+  Option::outputDir = ".";
+  Option::oracleFile = Command;
+  Option::saveTemp = false;
+  // the callback answers one candidate at a time anyway
+  Option::jobs = Check ? 1 : Options.jobs;
+  Option::timeBudget = Options.timeBudget;
+  Option::maxRSS = 0;
+  Option::skipGlobal = !Options.global;
+  Option::skipLocal = !Options.local;
+  Option::tokenReduction = Options.token;
+  Option::coverage = false;
+  Option::linePrepass = Options.linePrepass;
+  Option::memoize = Options.memoize;
+  Option::globalDep = Options.globalDep;
+  Option::localDep = Options.localDep;
+  Option::skipDCE = !Options.dce;
+  Option::profile = false;
+  Option::eventLog = Option::reportJson = Option::statusFile = "";
+  Option::traceFile = "";
+  Option::verbose = false;
+  if (Check)
+    Oracle::use(std::unique_ptr<Oracle>(
+        new CallbackOracle([requests, replies](const std::string &program) {
+          char verdict = 0;
+          if (!sendMessage(requests, CheckMessage, program) ||
+              !readAll(replies, &verdict, 1))
+            _exit(1);
+          return verdict == 1;
+        })));
+  else
+    Oracle::use(std::unique_ptr<Oracle>(new ExternalOracle(Command)));
+  Report::reset();
+  ElementMemo::clear();
+  Budget::start(Options.timeBudget);
+  Memory::setLimit(0);
+  TransformationManager::GetInstance()->setSrcFileName(Name);
+
+  Report::totalProfiler.startTimer();
+  reduceFile(Mode);
+  Report::totalProfiler.stopTimer();
+
+  // forked local workers only report into the phase counters
+  std::ostringstream stats;
+  stats << Report::lineCallsCounter.count() +
+               Report::globalCallsCounter.count() +
+               Report::localCallsCounter.count() +
+               Report::tokenCallsCounter.count()
+        << " "
+        << Report::successfulLineCallsCounter.count() +
+               Report::successfulGlobalCallsCounter.count() +
+               Report::successfulLocalCallsCounter.count() +
+               Report::successfulTokenCallsCounter.count()
+        << " " << Report::totalProfiler.getElapsedTime() << " "
+        << Report::oracleProfiler.getElapsedTime() << " "
+        << Report::parseProfiler.getElapsedTime();
+  _exit(sendMessage(requests, StatsMessage, stats.str()) ? 0 : 1);
+}
+
+ReductionResult ReductionSession::run() {
+  ReductionResult result;
+  if (!Check && Command.empty()) {
+    result.error = "no oracle";
+    return result;
+  }
+
+  // a private directory holds the program and whatever the passes write
+  std::string pattern = Options.workDir + "/chisel-session-XXXXXX";
+  if (mkdtemp(&pattern[0]) == NULL) {
+    result.error = "cannot create a directory in " + Options.workDir;
+    return result;
+  }
+  std::string dir = pattern;
+  std::string input = dir + "/" + Name;
+  if (Name.find('/') != std::string::npos || !writeFile(input, Program)) {
+    Sandbox::remove(dir);
+    result.error = "cannot write " + input;
+    return result;
+  }
+
+  int requests[2], replies[2];
+  if (pipe(requests) != 0) {
+    Sandbox::remove(dir);
+    result.error = "cannot create a pipe";
+    return result;
+  }
+  if (pipe(replies) != 0) {
+    close(requests[0]);
+    close(requests[1]);
+    Sandbox::remove(dir);
+    result.error = "cannot create a pipe";
+    return result;
+  }
+  // neither the oracles of this session nor other sessions inherit them
+  for (int fd : {requests[0], requests[1], replies[0], replies[1]})
+    setCloseOnExec(fd);
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(requests[0]);
+    close(replies[1]);
+    reduceInChild(dir, requests[1], replies[0]);
+  }
+  close(requests[1]);
+  close(replies[0]);
+
+  // answer the callback in this thread until the child is done
+  bool finished = false;
+  std::string stats;
+  char kind;
+  std::string text;
+  try {
+    while (pid > 0 && !finished && receiveMessage(requests[0], kind, text)) {
+      if (kind == StatsMessage) {
+        stats = text;
+        finished = true;
+      } else if (kind == CheckMessage) {
+        char verdict = Check(text) ? 1 : 0;
+        if (!writeAll(replies[1], &verdict, 1))
+          break;
+      } else {
+        break;
+      }
+    }
+  } catch (...) {
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    close(requests[0]);
+    close(replies[1]);
+    Sandbox::remove(dir);
+    throw;
+  }
+  close(requests[0]);
+  close(replies[1]);
+  int status = 0;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0 || !finished) {
+    Sandbox::remove(dir);
+    result.error = pid < 0 ? "cannot fork" : "the reduction failed";
+    return result;
+  }
+
+  result.ok = true;
+  result.program = readFile(input);
+  std::istringstream iss(stats);
+  iss >> result.stats.oracleCalls >> result.stats.successfulCalls >>
+      result.stats.seconds >> result.stats.oracleSeconds >>
+      result.stats.parseSeconds;
+  result.stats.originalBytes = Stats::getByteCount(Program);
+  result.stats.finalBytes = Stats::getByteCount(result.program);
+  Sandbox::remove(dir);
+  return result;
+}
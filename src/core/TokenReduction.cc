@@ -0,0 +1,134 @@
+#include "clang/AST/ASTContext.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+
+#include <algorithm>
+#include <map>
+
+#include "Budget.h"
+#include "Options.h"
+#include "Profiling.h"
+#include "Status.h"
+#include "TokenReduction.h"
+#include "TransformationManager.h"
+#include "VectorUtils.h"
+
+using namespace clang;
+
+static const char *DescriptionMsg = "Perform token-level reduction";
+
+static RegisterTransformation<TokenReduction> Trans("token-reduction",
+                                                    DescriptionMsg);
+
+void TokenReduction::HandleTranslationUnit(ASTContext &Ctx) {
+  endParse();
+  tokenReduction();
+}
+
+void TokenReduction::collectCandidates(std::vector<Range> &tokens,
+                                       std::vector<Range> &groups) {
+  FileID MainFileID = SrcManager->getMainFileID();
+  Lexer Lex(MainFileID, SrcManager->getBuffer(MainFileID), *SrcManager,
+            Context->getLangOpts());
+
+  // every token, and every bracketed group from its opening to its matching
+  // closing token
+  std::vector<unsigned> open;
+  Token Tok;
+  while (true) {
+    Lex.LexFromRawLexer(Tok);
+    if (Tok.is(tok::eof))
+      break;
+    unsigned begin = SrcManager->getFileOffset(Tok.getLocation());
+    unsigned end = begin + Tok.getLength();
+    tokens.emplace_back(Range(begin, end));
+    if (Tok.isOneOf(tok::l_paren, tok::l_square, tok::l_brace)) {
+      open.emplace_back(begin);
+    } else if (Tok.isOneOf(tok::r_paren, tok::r_square, tok::r_brace) &&
+               !open.empty()) {
+      groups.emplace_back(Range(open.back(), end));
+      open.pop_back();
+    }
+  }
+}
+
+bool TokenReduction::test(std::vector<Range> &toBeRemoved) {
+  SourceVersion candidate = Source.blank(toBeRemoved);
+
+  // skip the oracle for candidates that no longer parse
+  if (TransformationManager::getNumParseErrors(candidate.str()) > BaseErrors)
+    return false;
+
+  SourceVersion before = Source;
+  Source = candidate;
+  Transformation::writeToFile(Option::inputFile);
+
+  if (Transformation::callOracle("token")) {
+    return true;
+  } else {
+    revert(before);
+    return false;
+  }
+}
+
+void TokenReduction::ddmin(std::vector<Range> ranges) {
+  std::map<Range, unsigned> weights;
+  for (auto const &range : ranges)
+    weights[range] = range.second - range.first;
+  VectorUtils::sortByWeight<Range>(ranges, weights);
+
+  int n = 2;
+  while (ranges.size() >= 1 && !Budget::expired()) {
+    std::vector<std::vector<Range>> subsets =
+        VectorUtils::splitByWeight<Range>(ranges, n, weights);
+    bool complementSucceeding = false;
+    Status::startRound(ranges.size(), subsets.size());
+
+    // the subsets are consecutive slices of ranges, so the complement of one
+    // is ranges without the slice starting at begin
+    size_t begin = 0;
+    for (auto &subset : subsets) {
+      Status::nextCandidate();
+      if (test(subset)) {
+        ranges.erase(ranges.begin() + begin,
+                     ranges.begin() + begin + subset.size());
+        n = std::max(n - 1, 2);
+        complementSucceeding = true;
+        break;
+      }
+      begin += subset.size();
+    }
+
+    if (!complementSucceeding) {
+      if (n == ranges.size()) {
+        break;
+      }
+
+      n = std::min(n * 2, static_cast<int>(ranges.size()));
+    }
+  }
+}
+
+void TokenReduction::tokenReduction(void) {
+  BaseErrors = TransformationManager::getNumParseErrors(getRewrittenSource());
+
+  std::vector<Range> tokens, groups;
+  {
+    Span span("candidates", "collect");
+    collectCandidates(tokens, groups);
+  }
+
+  // balanced groups first, then whatever single tokens are still there
+  ddmin(groups);
+  std::string source = getRewrittenSource();
+  std::vector<Range> remaining;
+  for (auto const &token : tokens) {
+    std::string text =
+        source.substr(token.first, token.second - token.first);
+    if (text.find_first_not_of(" \t\r\n") != std::string::npos)
+      remaining.emplace_back(token);
+  }
+  ddmin(remaining);
+}
+
+TokenReduction::~TokenReduction(void) {}
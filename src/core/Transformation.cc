@@ -4,6 +4,13 @@
 
 #include "Transformation.h"
 
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
 #include <sstream>
 
 #include "clang/AST/ASTContext.h"
@@ -13,8 +20,15 @@
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "Budget.h"
+#include "EventLog.h"
 #include "Options.h"
+#include "Oracle.h"
 #include "Report.h"
+#include "Sandbox.h"
+#include "Stats.h"
+#include "Status.h"
+#include "TempArchive.h"
 
 using namespace clang;
 
@@ -66,19 +80,25 @@ bool TransNameQueryWrap::TraverseDecl(Decl *D) {
 }
 
 void Transformation::Initialize(ASTContext &context) {
+  ParseBegin = Trace::now();
+  Report::parseProfiler.startTimer();
   Context = &context;
   SrcManager = &Context->getSourceManager();
   TheRewriter.setSourceMgr(Context->getSourceManager(), Context->getLangOpts());
   RewriteHelper = RewriteUtils::GetInstance(&TheRewriter);
+  Source = SourceVersion(
+      SrcManager->getBufferData(SrcManager->getMainFileID()).str());
+  Best = Source;
+  publishSize();
+  NodeKind = NULL;
+  // candidates of this parse are saved as blanks on top of its source
+  if (Option::saveTemp)
+    ArchiveBase = TempArchive::addBase(
+        SrcManager->getBufferData(SrcManager->getMainFileID()).str());
 }
 
 void Transformation::outputTransformedSource(llvm::raw_ostream &OutStream) {
-  FileID MainFileID = SrcManager->getMainFileID();
-  const RewriteBuffer *RWBuf = TheRewriter.getRewriteBufferFor(MainFileID);
-
-  // RWBuf is non-empty upon any rewrites
-  TransAssert(RWBuf && "Empty RewriteBuffer!");
-  OutStream << std::string(RWBuf->begin(), RWBuf->end());
+  OutStream << Source.str();
   OutStream.flush();
 }
 
@@ -992,6 +1012,55 @@ bool Transformation::isInIncludedFile(const Stmt *S) const {
   return isInIncludedFile(S->getLocStart());
 }
 
+SourceLocation Transformation::getEndLocation(Stmt *last) {
+  if (CompoundStmt *CS = dyn_cast<CompoundStmt>(last)) {
+    return CS->getRBracLoc().getLocWithOffset(1);
+  } else if (IfStmt *IS = dyn_cast<IfStmt>(last)) {
+    return last->getSourceRange().getEnd().getLocWithOffset(1);
+  } else if (WhileStmt *WS = dyn_cast<WhileStmt>(last)) {
+    return last->getSourceRange().getEnd().getLocWithOffset(1);
+  } else if (LabelStmt *LS = dyn_cast<LabelStmt>(last)) {
+    auto subStmt = LS->getSubStmt();
+    if (CompoundStmt *LS_CS = dyn_cast<CompoundStmt>(subStmt)) {
+      return LS_CS->getRBracLoc().getLocWithOffset(1);
+    } else {
+      return RewriteHelper->getEndLocationUntil(subStmt->getSourceRange(), ';')
+          .getLocWithOffset(1);
+    }
+  } else if (ForStmt *FS = dyn_cast<ForStmt>(last)) {
+    return getEndLocation(FS->getBody());
+  } else if (DoStmt *DS = dyn_cast<DoStmt>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  } else if (SwitchStmt *SS = dyn_cast<SwitchStmt>(last)) {
+    return getEndLocation(SS->getBody());
+  } else if (SwitchCase *SC = dyn_cast<SwitchCase>(last)) {
+    return getEndLocation(SC->getSubStmt());
+  } else if (BinaryOperator *BO = dyn_cast<BinaryOperator>(last)) {
+    return RewriteHelper->getEndLocationAfter(last->getSourceRange(), ';');
+  } else if (ReturnStmt *RS = dyn_cast<ReturnStmt>(last)) {
+    return RewriteHelper->getEndLocationAfter(RS->getSourceRange(), ';');
+  } else if (GotoStmt *GS = dyn_cast<GotoStmt>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  } else if (BreakStmt *BS = dyn_cast<BreakStmt>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  } else if (ContinueStmt *CS = dyn_cast<ContinueStmt>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  } else if (DeclStmt *DS = dyn_cast<DeclStmt>(last)) {
+    return RewriteHelper->getEndLocationAfter(last->getSourceRange(), ';');
+  } else if (CallExpr *CE = dyn_cast<CallExpr>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  } else if (UnaryOperator *UO = dyn_cast<UnaryOperator>(last)) {
+    return RewriteHelper->getEndLocationUntil(last->getSourceRange(), ';')
+        .getLocWithOffset(1);
+  }
+  return SourceLocation();
+}
+
 std::string Transformation::getSourceText(SourceRange SR) {
   const SourceManager *SM = &Context->getSourceManager();
   llvm::StringRef ref = Lexer::getSourceText(CharSourceRange::getCharRange(SR),
@@ -999,45 +1068,237 @@ std::string Transformation::getSourceText(SourceRange SR) {
   return ref.str();
 }
 
+std::string Transformation::getRewrittenSource() { return Source.str(); }
+
+// [begin, end) of a token range in the main file, as the rewriter measures it
+bool Transformation::getByteRange(SourceRange SR, Range &R) {
+  SourceLocation B = SR.getBegin(), E = SR.getEnd();
+  if (B.isInvalid() || E.isInvalid() || B.isMacroID() || E.isMacroID() ||
+      !SrcManager->isInMainFile(B) || !SrcManager->isInMainFile(E))
+    return false;
+  unsigned Begin = SrcManager->getFileOffset(B);
+  unsigned End = SrcManager->getFileOffset(E) +
+                 Lexer::MeasureTokenLength(E, *SrcManager,
+                                           Context->getLangOpts());
+  if (End < Begin)
+    return false;
+  R = Range(Begin, End);
+  return true;
+}
+
+bool Transformation::getByteRanges(const std::vector<SourceRange> &SRs,
+                                   std::vector<Range> &Rs) {
+  for (auto const &SR : SRs) {
+    Range R;
+    if (!getByteRange(SR, R))
+      return false;
+    Rs.emplace_back(R);
+  }
+  return true;
+}
+
+std::string Transformation::getRewrittenText(Range R) {
+  return Source.getText(R);
+}
+
 void Transformation::writeToFile(std::string filename) {
-  std::error_code error_code;
-  llvm::raw_fd_ostream outFile(filename.c_str(), error_code,
-                               llvm::sys::fs::F_None);
-  TheRewriter.getEditBuffer(Context->getSourceManager().getMainFileID())
-      .write(outFile);
-  outFile.close();
+  Span span("write", "write");
+  Source.writeToFile(filename);
+}
+
+void Transformation::revert(const SourceVersion &Version) {
+  Span span("revert", "revert");
+  Source = Version;
+  Transformation::writeToFile(Option::inputFile);
+}
+
+void Transformation::endParse() {
+  Report::parseProfiler.stopTimer();
+  Trace::complete("parse", "parse", ParseBegin, Name);
 }
 
 void Transformation::printToTerminal() {
   llvm::outs() << "==========================";
-  auto buffer = TheRewriter.getRewriteBufferFor(
-      Context->getSourceManager().getMainFileID());
-  if (buffer != nullptr)
-    buffer->write(llvm::outs());
+  llvm::outs() << Source.str();
   llvm::outs() << "=========================\n";
 }
 
-bool Transformation::callOracle(std::string msg) {
+static void countCall(const std::string &msg) {
   if (msg == "global")
     Report::globalCallsCounter.increment();
   else if (msg == "local" || msg == "if" || msg == "loop")
     Report::localCallsCounter.increment();
+  else if (msg == "token")
+    Report::tokenCallsCounter.increment();
+  Report::callsByKind[msg].increment();
+  Status::countCalls(1, 0);
+}
+
+static void countSuccess(const std::string &msg) {
+  if (msg == "global")
+    Report::successfulGlobalCallsCounter.increment();
+  else if (msg == "local" || msg == "if" || msg == "loop")
+    Report::successfulLocalCallsCounter.increment();
+  else if (msg == "token")
+    Report::successfulTokenCallsCounter.increment();
+  Report::successfulCallsByKind[msg].increment();
+  Status::countCalls(0, 1);
+}
+
+static std::string getTempName(const std::string &msg) {
   int totalCalls =
       Report::localCallsCounter.count() + Report::globalCallsCounter.count();
-  std::string tempName = Option::outputDir + "/" + Option::inputFile + "." +
-                         std::to_string(totalCalls) + "." + msg + ".";
-  if (system(Option::oracleFile.c_str()) == 0) {
-    if (msg == "global")
-      Report::successfulGlobalCallsCounter.increment();
-    else if (msg == "local" || msg == "if" || msg == "loop")
-      Report::successfulLocalCallsCounter.increment();
+  return Option::inputFile + "." + std::to_string(totalCalls) + "." + msg +
+         ".";
+}
+
+void Transformation::saveTemp(const std::string &name,
+                              const SourceVersion &candidate) {
+  TempArchive::addCandidate(ArchiveBase, name,
+                            candidate.getBlanks(Range(0, candidate.size())));
+}
+
+// the status file counts the bytes that are not whitespace, like the report
+void Transformation::publishSize() {
+  if (!Option::statusFile.empty())
+    Status::setSize(Stats::getByteCount(Best.str()));
+}
+
+void Transformation::saveBest() {
+  Best = Source;
+  publishSize();
+  // an anytime run always leaves the best result so far in the output;
+  // written aside and renamed, so that a kill never leaves half a file
+  if (Budget::isLimited() && !Option::outputFile.empty()) {
+    Span span("write", "write");
+    std::string temp = Option::outputFile + ".tmp";
+    if (Best.writeToFile(temp))
+      std::rename(temp.c_str(), Option::outputFile.c_str());
+  }
+}
+
+bool Transformation::callOracle(std::string msg) {
+  // out of time: reject every further candidate so that the passes wind down
+  if (Budget::expired())
+    return false;
+  countCall(msg);
+  std::string tempName = getTempName(msg);
+  Report::oracleProfiler.startTimer();
+  Report::oracleProfilerByKind[msg].startTimer();
+  int status;
+  {
+    Span span("oracle", "oracle", msg);
+    double cpu = EventLog::getChildrenCPUTime();
+    long long begin = Trace::now();
+    status = Oracle::run();
+    double wall = (Trace::now() - begin) / 1e9;
+    Report::oracleTimes.emplace_back(wall);
+    logCall(msg, Source, status, wall, EventLog::getChildrenCPUTime() - cpu);
+  }
+  Report::oracleProfilerByKind[msg].stopTimer();
+  Report::oracleProfiler.stopTimer();
+  if (status == 0) {
+    countSuccess(msg);
     if (Option::saveTemp)
-      Transformation::writeToFile(tempName + "success.c");
+      saveTemp(tempName + "success.c", Source);
+    saveBest();
     return true;
   }
   if (Option::saveTemp)
-    Transformation::writeToFile(tempName + "fail.c");
+    saveTemp(tempName + "fail.c", Source);
   return false;
 }
 
+std::vector<bool>
+Transformation::callOracles(const std::vector<SourceVersion> &versions,
+                            std::string msg) {
+  // every candidate runs in its own sandbox, up to Option::jobs at a time;
+  // neither the rewriter nor the input file is touched
+  std::vector<bool> results(versions.size(), false);
+  if (Budget::expired())
+    return results;
+  std::map<pid_t, int> running;
+  std::vector<long long> begins(versions.size(), 0);
+  int next = 0;
+  llvm::outs().flush();
+  Span span("oracles", "oracle", msg);
+  Report::oracleProfiler.startTimer();
+  Report::oracleProfilerByKind[msg].startTimer();
+  // an in-process oracle needs neither a fork nor a sandbox
+  for (; next < versions.size() && !Oracle::get()->isExternal(); next++) {
+    long long begin = Trace::now();
+    int status = Oracle::get()->check(versions[next].str());
+    double wall = (Trace::now() - begin) / 1e9;
+    results[next] = status == 0;
+    Report::oracleTimes.emplace_back(wall);
+    logCall(msg, versions[next], status, wall, 0);
+  }
+  while (next < versions.size() || !running.empty()) {
+    while (running.size() < Option::jobs && next < versions.size()) {
+      std::string dir = Sandbox::getPath(next);
+      pid_t pid = fork();
+      if (pid == 0) {
+        if (!Sandbox::create(dir) || chdir(dir.c_str()) != 0)
+          _exit(1);
+        versions[next].writeToFile(Option::inputFile);
+        int code = EventLog::getExitCode(Oracle::run());
+        _exit(code < 0 ? 255 : code);
+      }
+      if (pid < 0)
+        break;
+      begins[next] = Trace::now();
+      running[pid] = next++;
+    }
+    if (running.empty()) // cannot fork; leave the rest rejected
+      break;
+
+    int status;
+    struct rusage usage;
+    pid_t pid = wait4(-1, &status, 0, &usage);
+    if (pid < 0)
+      break;
+    int i = running[pid];
+    running.erase(pid);
+    results[i] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    double wall = (Trace::now() - begins[i]) / 1e9;
+    Report::oracleTimes.emplace_back(wall);
+    logCall(msg, versions[i], status, wall,
+            usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6);
+    Sandbox::remove(Sandbox::getPath(i));
+  }
+  Report::oracleProfilerByKind[msg].stopTimer();
+  Report::oracleProfiler.stopTimer();
+
+  for (int i = 0; i < versions.size(); i++) {
+    countCall(msg);
+    if (results[i])
+      countSuccess(msg);
+    if (Option::saveTemp)
+      saveTemp(getTempName(msg) + (results[i] ? "success.c" : "fail.c"),
+               versions[i]);
+  }
+  return results;
+}
+
+void Transformation::logCall(const std::string &msg,
+                             const SourceVersion &candidate, int status,
+                             double wall, double cpu) {
+  if (!EventLog::isOpen())
+    return;
+  EventLog::Record record;
+  record.phase = Name;
+  record.kind = msg;
+  record.node = NodeKind ? NodeKind : "";
+  unsigned blanked = candidate.getBlankedSize();
+  record.removed = blanked - std::min(blanked, Best.getBlankedSize());
+  record.size = candidate.size() - blanked;
+  record.hash = candidate.hash();
+  record.verdict = status == 0;
+  record.wall = wall;
+  record.cpu = cpu;
+  record.exitCode = EventLog::getExitCode(status);
+  EventLog::record(record);
+}
+
 Transformation::~Transformation(void) { RewriteUtils::Finalize(); }
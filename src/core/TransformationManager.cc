@@ -5,13 +5,17 @@
 #include "TransformationManager.h"
 
 #include "clang/Basic/Diagnostic.h"
+#include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Parse/ParseAST.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include <iostream>
 #include <sstream>
 
+#include "Profiling.h"
+#include "Status.h"
 #include "Transformation.h"
 
 using namespace clang;
@@ -46,10 +50,7 @@ bool TransformationManager::isCLangOpt() {
 }
 
 bool TransformationManager::initializeCompilerInstance(std::string &ErrorMsg) {
-  /*if (ClangInstance) {
-    ErrorMsg = "CompilerInstance has been initialized!";
-    return false;
-  }*/
+  releaseCompilerInstance();
 
   ClangInstance = new CompilerInstance();
   assert(ClangInstance);
@@ -95,22 +96,79 @@ bool TransformationManager::initializeCompilerInstance(std::string &ErrorMsg) {
   return true;
 }
 
+// Parses Source in-process, without a transformation attached, and counts the
+// errors. Used to reject syntactically broken candidates without calling the
+// oracle.
+unsigned TransformationManager::getNumParseErrors(const std::string &Source) {
+  return parse(Source, GetInstance()->SrcFileName,
+               llvm::make_unique<ASTConsumer>());
+}
+
+// Parses Source in a throwaway CompilerInstance, feeding Consumer, and returns
+// the number of errors.
+unsigned TransformationManager::parse(const std::string &Source,
+                                      const std::string &Name,
+                                      std::unique_ptr<ASTConsumer> Consumer) {
+  CompilerInstance CI;
+  CI.createDiagnostics(new DiagnosticConsumer());
+
+  TargetOptions &TargetOpts = CI.getTargetOpts();
+  PreprocessorOptions &PPOpts = CI.getPreprocessorOpts();
+  TargetOpts.Triple = LLVM_DEFAULT_TARGET_TRIPLE;
+  llvm::Triple T(TargetOpts.Triple);
+  CI.getInvocation().setLangDefaults(CI.getLangOpts(), InputKind::C, T,
+                                     PPOpts);
+  CI.setTarget(TargetInfo::CreateTargetInfo(CI.getDiagnostics(),
+                                            CI.getInvocation().TargetOpts));
+
+  CI.createFileManager();
+  CI.createSourceManager(CI.getFileManager());
+  CI.createPreprocessor(TU_Complete);
+  CI.getDiagnosticClient().BeginSourceFile(CI.getLangOpts(),
+                                           &CI.getPreprocessor());
+  CI.createASTContext();
+  CI.setASTConsumer(std::move(Consumer));
+  Preprocessor &PP = CI.getPreprocessor();
+  PP.getBuiltinInfo().initializeBuiltins(PP.getIdentifierTable(),
+                                         PP.getLangOpts());
+
+  SourceManager &SM = CI.getSourceManager();
+  SM.setMainFileID(SM.createFileID(llvm::MemoryBuffer::getMemBufferCopy(
+      Source, Name)));
+
+  CI.createSema(TU_Complete, 0);
+  ParseAST(CI.getSema());
+  CI.getDiagnosticClient().EndSourceFile();
+  return CI.getDiagnosticClient().getNumErrors();
+}
+
+// Frees the CompilerInstance of the last phase together with its AST, Sema,
+// Preprocessor and SourceManager. The transformation it was parsing for is
+// taken back first; transformations live until Finalize.
+void TransformationManager::releaseCompilerInstance() {
+  if (!ClangInstance)
+    return;
+  if (ClangInstance->hasASTConsumer())
+    static_cast<Transformation *>(ClangInstance->takeASTConsumer().release())
+        ->releaseSource();
+  delete ClangInstance;
+  ClangInstance = NULL;
+}
+
 void TransformationManager::Finalize() {
   assert(TransformationManager::Instance);
 
+  Instance->releaseCompilerInstance();
+
   std::map<std::string, Transformation *>::iterator I, E;
   for (I = Instance->TransformationsMap.begin(),
       E = Instance->TransformationsMap.end();
        I != E; ++I) {
-    // CurrentTransformationImpl will be freed by ClangInstance
-    if ((*I).second != Instance->CurrentTransformationImpl)
-      delete (*I).second;
+    delete (*I).second;
   }
   if (Instance->TransformationsMapPtr)
     delete Instance->TransformationsMapPtr;
 
-  delete Instance->ClangInstance;
-
   delete Instance;
   Instance = NULL;
 }
@@ -134,6 +192,8 @@ void TransformationManager::closeOutStream(llvm::raw_ostream *OutStream) {
 bool TransformationManager::doTransformation(std::string &ErrorMsg,
                                              int &ErrorCode) {
   ErrorMsg = "";
+  Span span(CurrentTransName, "transformation");
+  Status::setPhase(CurrentTransName);
 
   ClangInstance->createSema(TU_Complete, 0);
   DiagnosticsEngine &Diag = ClangInstance->getDiagnostics();
@@ -153,7 +213,8 @@ bool TransformationManager::doTransformation(std::string &ErrorMsg,
     }
   }
 
-  ParseAST(ClangInstance->getSema());
+  ParseAST(ClangInstance->getSema(), false,
+           CurrentTransformationImpl->skipFunctionBodies());
 
   ClangInstance->getDiagnosticClient().EndSourceFile();
 
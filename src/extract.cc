@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "TempArchive.h"
+
+const std::string usage("Usage: chisel-extract ARCHIVE [NAME|INDEX [OUTPUT]]\n"
+                        "       chisel-extract ARCHIVE --all DIR");
+
+static bool writeFile(const std::string &path, const std::string &text) {
+  std::ofstream ofs(path, std::ios::binary);
+  ofs << text;
+  return static_cast<bool>(ofs);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 4) {
+    std::cerr << usage << std::endl;
+    return 1;
+  }
+  std::vector<std::string> bases;
+  std::vector<TempArchive::Candidate> candidates;
+  if (!TempArchive::read(argv[1], bases, candidates)) {
+    std::cerr << "chisel-extract: " << argv[1] << " is not a valid archive"
+              << std::endl;
+    return 1;
+  }
+
+  // without a candidate, list them
+  if (argc == 2) {
+    for (int i = 0; i < candidates.size(); i++)
+      std::cout << i << "\t" << candidates[i].name << "\tbase "
+                << candidates[i].base << "\t" << candidates[i].blanks.size()
+                << " ranges" << std::endl;
+    return 0;
+  }
+
+  std::string which = argv[2];
+  if (which == "--all") {
+    if (argc != 4) {
+      std::cerr << usage << std::endl;
+      return 1;
+    }
+    std::string dir = argv[3];
+    mkdir(dir.c_str(), ACCESSPERMS);
+    for (auto const &candidate : candidates) {
+      if (candidate.base >= bases.size())
+        continue;
+      // the file names --save_temp used to write
+      std::string name = candidate.name;
+      for (auto &chr : name)
+        if (chr == '/')
+          chr = '_';
+      if (!writeFile(dir + "/" + name,
+                     TempArchive::rebuild(bases[candidate.base],
+                                          candidate.blanks))) {
+        std::cerr << "chisel-extract: cannot write " << dir << "/" << name
+                  << std::endl;
+        return 1;
+      }
+    }
+    return 0;
+  }
+
+  // by name, or else by index
+  int index = -1;
+  for (int i = 0; i < candidates.size() && index < 0; i++)
+    if (candidates[i].name == which)
+      index = i;
+  if (index < 0 && which.find_first_not_of("0123456789") == std::string::npos)
+    index = atoi(which.c_str());
+  if (index < 0 || index >= candidates.size() ||
+      candidates[index].base >= bases.size()) {
+    std::cerr << "chisel-extract: no candidate " << which << std::endl;
+    return 1;
+  }
+  std::string text = TempArchive::rebuild(bases[candidates[index].base],
+                                          candidates[index].blanks);
+  if (argc == 3) {
+    std::cout << text;
+    return 0;
+  }
+  if (!writeFile(argv[3], text)) {
+    std::cerr << "chisel-extract: cannot write " << argv[3] << std::endl;
+    return 1;
+  }
+  return 0;
+}
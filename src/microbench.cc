@@ -0,0 +1,266 @@
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Transformation.h"
+#include "TransformationManager.h"
+
+using namespace clang;
+
+const std::string usage(
+    "Usage: chisel-microbench [--filter REGEX] [--min_time SECONDS] FILE...\n"
+    "Times the rewrite helpers per call on the ASTs of FILEs");
+
+// Google Benchmark style: the body loops while keepRunning() and can leave
+// its setup out of the measurement with pauseTiming()/resumeTiming().
+class State {
+public:
+  explicit State(unsigned long long iterations)
+      : Iterations(iterations), Done(0), Elapsed(0) {}
+
+  bool keepRunning() {
+    if (Done == 0)
+      resumeTiming();
+    if (Done < Iterations) {
+      Done++;
+      return true;
+    }
+    pauseTiming();
+    return false;
+  }
+
+  void pauseTiming() { Elapsed += std::chrono::steady_clock::now() - Start; }
+  void resumeTiming() { Start = std::chrono::steady_clock::now(); }
+
+  // the iteration being run, counting from 0
+  unsigned long long index() const { return Done - 1; }
+  double seconds() const {
+    return std::chrono::duration<double>(Elapsed).count();
+  }
+
+private:
+  unsigned long long Iterations;
+  unsigned long long Done;
+  std::chrono::steady_clock::time_point Start;
+  std::chrono::steady_clock::duration Elapsed;
+};
+
+// results go here so that the helpers are not optimized away
+static volatile unsigned long long Sink;
+
+// The helpers run on the AST of one file, cycling through its statements and
+// declarations so that every call sees a different, realistic node.
+class MicroBench : public Transformation {
+  class CollectionVisitor;
+
+public:
+  MicroBench(const std::string &file, const std::regex &filter,
+             double minTime)
+      : Transformation("microbench", "Time the rewrite helpers"), File(file),
+        Filter(filter), MinTime(minTime) {}
+
+private:
+  typedef std::function<void(State &)> Body;
+
+  virtual bool HandleTopLevelDecl(DeclGroupRef D);
+  virtual void HandleTranslationUnit(ASTContext &Ctx);
+  void run(const std::string &name, size_t count, const Body &body);
+  void resetRewriter();
+  bool isInMainFile(SourceLocation Loc) {
+    return Loc.isFileID() && SrcManager->isInMainFile(Loc);
+  }
+
+  std::string File;
+  std::regex Filter;
+  double MinTime;
+
+  std::vector<DeclGroupRef> Groups;
+  std::vector<Stmt *> Stmts;
+  std::vector<VarDecl *> LocalVars;
+};
+
+class MicroBench::CollectionVisitor
+    : public RecursiveASTVisitor<CollectionVisitor> {
+public:
+  explicit CollectionVisitor(MicroBench *bench) : Bench(bench) {}
+
+  bool VisitCompoundStmt(CompoundStmt *CS) {
+    for (auto S : CS->body())
+      if (Bench->isInMainFile(S->getLocStart()))
+        Bench->Stmts.emplace_back(S);
+    return true;
+  }
+
+  bool VisitDeclStmt(DeclStmt *DS) {
+    for (auto D : DS->decls())
+      if (VarDecl *VD = dyn_cast<VarDecl>(D))
+        if (Bench->isInMainFile(VD->getLocation()))
+          Bench->LocalVars.emplace_back(VD);
+    return true;
+  }
+
+private:
+  MicroBench *Bench;
+};
+
+bool MicroBench::HandleTopLevelDecl(DeclGroupRef D) {
+  if (!D.isNull() && isInMainFile((*D.begin())->getLocation()))
+    Groups.emplace_back(D);
+  return true;
+}
+
+void MicroBench::resetRewriter() {
+  TheRewriter = Rewriter();
+  TheRewriter.setSourceMgr(*SrcManager, Context->getLangOpts());
+  RewriteHelper = RewriteUtils::GetInstance(&TheRewriter);
+}
+
+// Grows the iterations until a run takes MinTime, like Google Benchmark.
+void MicroBench::run(const std::string &name, size_t count, const Body &body) {
+  std::string fullName = name + "/" + File;
+  if (count == 0 || !std::regex_search(fullName, Filter))
+    return;
+  resetRewriter();
+  unsigned long long iterations = 1;
+  while (true) {
+    State state(iterations);
+    body(state);
+    if (state.seconds() >= MinTime || iterations >= (1ULL << 40)) {
+      printf("%-60s %12.1f ns %12llu\n", fullName.c_str(),
+             state.seconds() * 1e9 / iterations, iterations);
+      return;
+    }
+    // aim a little past MinTime, at most 10x more per step
+    double scale = state.seconds() > 0 ? 1.4 * MinTime / state.seconds() : 10;
+    scale = std::min(std::max(scale, 1.0), 10.0);
+    iterations = std::max(iterations + 1,
+                          static_cast<unsigned long long>(iterations * scale));
+  }
+}
+
+void MicroBench::HandleTranslationUnit(ASTContext &Ctx) {
+  endParse();
+  CollectionVisitor(this).TraverseDecl(Ctx.getTranslationUnitDecl());
+
+  run("RewriteUtils::getEndLocationUntil", Stmts.size(), [&](State &state) {
+    while (state.keepRunning()) {
+      Stmt *S = Stmts[state.index() % Stmts.size()];
+      Sink += RewriteHelper->getEndLocationUntil(S->getSourceRange(), ';')
+                  .getRawEncoding();
+    }
+  });
+
+  run("RewriteUtils::getDeclGroupRefEndLoc", Groups.size(), [&](State &state) {
+    while (state.keepRunning())
+      Sink += RewriteHelper->getDeclGroupRefEndLoc(
+                                 Groups[state.index() % Groups.size()])
+                  .getRawEncoding();
+  });
+
+  run("RewriteUtils::getStmtIndentString", Stmts.size(), [&](State &state) {
+    while (state.keepRunning())
+      Sink += RewriteHelper
+                  ->getStmtIndentString(Stmts[state.index() % Stmts.size()],
+                                        SrcManager)
+                  .size();
+  });
+
+  // every declaration is removed once per rewriter; a fresh rewriter for the
+  // next round is not timed
+  run("RewriteUtils::removeVarDecl", LocalVars.size(), [&](State &state) {
+    while (state.keepRunning()) {
+      size_t i = state.index() % LocalVars.size();
+      if (i == 0 && state.index() > 0) {
+        state.pauseTiming();
+        resetRewriter();
+        state.resumeTiming();
+      }
+      Sink += RewriteHelper->removeVarDecl(LocalVars[i]);
+    }
+  });
+
+  run("Transformation::getSourceText", Stmts.size(), [&](State &state) {
+    while (state.keepRunning())
+      Sink += getSourceText(Stmts[state.index() % Stmts.size()]
+                                ->getSourceRange())
+                  .size();
+  });
+
+  run("Transformation::getByteRange", Stmts.size(), [&](State &state) {
+    Range R;
+    while (state.keepRunning())
+      Sink += getByteRange(Stmts[state.index() % Stmts.size()]
+                               ->getSourceRange(),
+                           R);
+  });
+
+  run("Transformation::getRewrittenText", Stmts.size(), [&](State &state) {
+    std::vector<Range> ranges;
+    for (auto S : Stmts) {
+      Range R;
+      if (getByteRange(S->getSourceRange(), R))
+        ranges.emplace_back(R);
+    }
+    if (ranges.empty())
+      return;
+    while (state.keepRunning())
+      Sink += getRewrittenText(ranges[state.index() % ranges.size()]).size();
+  });
+}
+
+int main(int argc, char **argv) {
+  std::regex filter(".*");
+  double minTime = 0.5;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      try {
+        filter = std::regex(argv[++i]);
+      } catch (const std::regex_error &e) {
+        std::cerr << "chisel-microbench: invalid filter " << argv[i]
+                  << std::endl;
+        return 1;
+      }
+    } else if (arg == "--min_time" && i + 1 < argc) {
+      minTime = atof(argv[++i]);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      std::cerr << usage << std::endl;
+      return 1;
+    } else {
+      files.emplace_back(arg);
+    }
+  }
+  if (files.empty()) {
+    std::cerr << usage << std::endl;
+    return 1;
+  }
+
+  printf("%-60s %15s %12s\n", "Benchmark", "Time", "Iterations");
+  for (auto const &file : files) {
+    std::ifstream ifs(file);
+    if (!ifs) {
+      std::cerr << "chisel-microbench: cannot read " << file << std::endl;
+      return 1;
+    }
+    std::stringstream buffer;
+    buffer << ifs.rdbuf();
+    std::string name = file.substr(file.find_last_of('/') + 1);
+    TransformationManager::parse(
+        buffer.str(), file,
+        std::unique_ptr<ASTConsumer>(new MicroBench(name, filter, minTime)));
+  }
+  return 0;
+}
@@ -0,0 +1,21 @@
+#include "Budget.h"
+
+#include <chrono>
+
+bool Budget::limited = false;
+long long Budget::deadline = 0;
+
+static long long now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Budget::start(int seconds) {
+  limited = seconds > 0;
+  deadline = now() + seconds * 1000000000LL;
+}
+
+bool Budget::isLimited() { return limited; }
+
+bool Budget::expired() { return limited && now() >= deadline; }
@@ -5,3 +5,5 @@ Counter::Counter() { c = 0; }
 unsigned int Counter::count() { return c; }
 
 void Counter::increment() { c++; }
+
+void Counter::add(unsigned int n) { c += n; }
@@ -0,0 +1,143 @@
+#include "Coverage.h"
+
+#include <dirent.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "Options.h"
+#include "Oracle.h"
+#include "Sandbox.h"
+#include "StringUtils.h"
+
+std::map<unsigned, long> Coverage::lineCounts;
+
+static bool hasSuffix(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static std::vector<std::string> listFiles(const std::string &suffix) {
+  std::vector<std::string> files;
+  DIR *dir = opendir(".");
+  if (dir == NULL)
+    return files;
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (hasSuffix(name, suffix))
+      files.emplace_back(name);
+  }
+  closedir(dir);
+  return files;
+}
+
+// Runs in a forked child inside a sandbox, so that neither the compiler nor
+// the cleanup below touches the coverage files of the working directory.
+static void runInSandbox(const std::string &dir, const std::string &input) {
+  if (!Sandbox::create(dir) || chdir(dir.c_str()) != 0)
+    _exit(2);
+  // the sandbox links the coverage files of the working directory; drop the
+  // links so that the build writes its own
+  for (auto const &suffix : {".gcda", ".gcno", ".gcov"})
+    for (auto const &file : listFiles(suffix))
+      unlink(file.c_str());
+  std::ifstream src(input, std::ios::binary);
+  std::ofstream dst(Option::inputFile, std::ios::binary);
+  dst << src.rdbuf();
+  dst.close();
+  if (!src || !dst)
+    _exit(2);
+
+  setenv("COV", "1", 1);
+  if (system(Option::oracleFile.c_str()) != 0)
+    _exit(1);
+  for (auto const &gcda : listFiles(".gcda")) {
+    std::string cmd = "gcov " + gcda + " > /dev/null 2>&1";
+    system(cmd.c_str());
+  }
+  _exit(0);
+}
+
+bool Coverage::collect(const std::string &srcPath) {
+  lineCounts.clear();
+  if (Oracle::isBuiltin(Option::oracleFile)) {
+    std::cerr << "chisel: a builtin oracle collects no coverage; "
+              << "skipping coverage-guided reduction." << std::endl;
+    return false;
+  }
+  char input[PATH_MAX];
+  if (!Sandbox::isSupported() || realpath(srcPath.c_str(), input) == NULL) {
+    std::cerr << "chisel: coverage needs the program as a relative path; "
+              << "skipping coverage-guided reduction." << std::endl;
+    return false;
+  }
+
+  // no oracle worker uses id -1
+  std::string dir = Sandbox::getPath(-1);
+  pid_t pid = fork();
+  if (pid == 0)
+    runInSandbox(dir, input);
+  int status = -1;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+      WEXITSTATUS(status) != 0) {
+    Sandbox::remove(dir);
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 1)
+      std::cerr << "chisel: the oracle fails on the original program; ";
+    else
+      std::cerr << "chisel: cannot run the oracle in a sandbox; ";
+    std::cerr << "skipping coverage-guided reduction." << std::endl;
+    return false;
+  }
+
+  std::string base = srcPath.substr(srcPath.find_last_of('/') + 1);
+  bool loaded = load(dir + "/" + base + ".gcov");
+  Sandbox::remove(dir);
+
+  if (!loaded)
+    std::cerr << "chisel: no coverage data found for " << srcPath
+              << "; does the oracle honor COV=1?" << std::endl;
+  return loaded;
+}
+
+bool Coverage::load(const std::string &gcovPath) {
+  std::ifstream ifs(gcovPath);
+  if (!ifs)
+    return false;
+  // each line reads "<count>:<line number>:<source>", where count is "-" for
+  // non-executable lines and "#####" or "=====" for lines never executed
+  std::string line;
+  while (std::getline(ifs, line)) {
+    auto fields = StringUtils::splitBy(line, ':');
+    if (fields.size() < 2)
+      continue;
+    std::string count = fields[0], number = fields[1];
+    count.erase(0, count.find_first_not_of(' '));
+    number.erase(0, number.find_first_not_of(' '));
+    if (count.empty() || count[0] == '-' || number.empty() ||
+        !isdigit(number[0]))
+      continue;
+    unsigned lineNo = std::stoul(number);
+    if (lineNo == 0)
+      continue;
+    if (count[0] == '#' || count[0] == '=')
+      lineCounts[lineNo] = 0;
+    else if (isdigit(count[0]))
+      lineCounts[lineNo] = std::stol(count);
+  }
+  return !lineCounts.empty();
+}
+
+bool Coverage::isExecutable(unsigned line) {
+  return lineCounts.find(line) != lineCounts.end();
+}
+
+bool Coverage::isExecuted(unsigned line) {
+  auto entry = lineCounts.find(line);
+  return entry != lineCounts.end() && entry->second > 0;
+}
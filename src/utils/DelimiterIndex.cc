@@ -0,0 +1,131 @@
+#include "DelimiterIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static bool isSpecial(char C) {
+  switch (C) {
+  case ';':
+  case '{':
+  case '}':
+  case ')':
+  case '/':
+  case '"':
+  case '\'':
+    return true;
+  default:
+    return false;
+  }
+}
+
+// the first delimiter, slash or quote in [P, E)
+static const char *skipToSpecial(const char *P, const char *E) {
+#ifdef __SSE2__
+  const __m128i Semi = _mm_set1_epi8(';');
+  const __m128i LBrace = _mm_set1_epi8('{');
+  const __m128i RBrace = _mm_set1_epi8('}');
+  const __m128i RParen = _mm_set1_epi8(')');
+  const __m128i Slash = _mm_set1_epi8('/');
+  const __m128i DQuote = _mm_set1_epi8('"');
+  const __m128i SQuote = _mm_set1_epi8('\'');
+  while (E - P >= 16) {
+    __m128i V = _mm_loadu_si128(reinterpret_cast<const __m128i *>(P));
+    __m128i M = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(V, Semi),
+                                  _mm_cmpeq_epi8(V, LBrace)),
+                     _mm_or_si128(_mm_cmpeq_epi8(V, RBrace),
+                                  _mm_cmpeq_epi8(V, RParen))),
+        _mm_or_si128(_mm_cmpeq_epi8(V, Slash),
+                     _mm_or_si128(_mm_cmpeq_epi8(V, DQuote),
+                                  _mm_cmpeq_epi8(V, SQuote))));
+    int Mask = _mm_movemask_epi8(M);
+    if (Mask)
+      return P + __builtin_ctz(Mask);
+    P += 16;
+  }
+#endif
+  while (P < E && !isSpecial(*P))
+    P++;
+  return P;
+}
+
+// past the closing Quote, or the end of the line for an unterminated literal
+static const char *skipLiteral(const char *P, const char *E, char Quote) {
+  while (P < E && *P != Quote && *P != '\n') {
+    if (*P == '\\' && P + 1 < E)
+      P++;
+    P++;
+  }
+  return P < E ? P + 1 : E;
+}
+
+bool DelimiterIndex::isIndexed(char Symbol) { return getSlot(Symbol) >= 0; }
+
+int DelimiterIndex::getSlot(char Symbol) {
+  switch (Symbol) {
+  case ';':
+    return 0;
+  case '{':
+    return 1;
+  case '}':
+    return 2;
+  case ')':
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+void DelimiterIndex::clear(void) {
+  Begin = End = nullptr;
+  for (auto &P : Positions)
+    P.clear();
+}
+
+void DelimiterIndex::build(const char *BufBegin, const char *BufEnd) {
+  clear();
+  Begin = BufBegin;
+  End = BufEnd;
+  const char *P = Begin;
+  while ((P = skipToSpecial(P, End)) < End) {
+    char C = *P;
+    if (C == '/' && P + 1 < End && P[1] == '/') {
+      const char *NL = static_cast<const char *>(memchr(P, '\n', End - P));
+      P = NL ? NL : End;
+    } else if (C == '/' && P + 1 < End && P[1] == '*') {
+      P += 2;
+      while (P + 1 < End && !(P[0] == '*' && P[1] == '/'))
+        P++;
+      P = std::min(P + 2, End);
+    } else if (C == '"' || C == '\'') {
+      P = skipLiteral(P + 1, End, C);
+    } else {
+      int Slot = getSlot(C);
+      if (Slot >= 0)
+        Positions[Slot].push_back(P - Begin);
+      P++;
+    }
+  }
+}
+
+int DelimiterIndex::findNext(const char *Buf, char Symbol) const {
+  const std::vector<unsigned> &P = Positions[getSlot(Symbol)];
+  unsigned Offset = Buf - Begin;
+  auto I = std::lower_bound(P.begin(), P.end(), Offset);
+  if (I == P.end())
+    return -1;
+  return *I - Offset;
+}
+
+int DelimiterIndex::findPrevious(const char *Buf, char Symbol) const {
+  const std::vector<unsigned> &P = Positions[getSlot(Symbol)];
+  unsigned Offset = Buf - Begin;
+  auto I = std::upper_bound(P.begin(), P.end(), Offset);
+  if (I == P.begin())
+    return 1;
+  return static_cast<int>(*(I - 1)) - static_cast<int>(Offset);
+}
@@ -0,0 +1,109 @@
+#include "ElementMemo.h"
+
+#include <cctype>
+#include <cstdio>
+#include <set>
+
+#include "Report.h"
+
+std::map<std::string, ElementMemo::Entry> ElementMemo::essentials;
+std::map<std::string, unsigned long> ElementMemo::lastRemoved;
+unsigned long ElementMemo::epoch = 0;
+
+static const std::set<std::string> keywords = {
+    "auto",     "break",    "case",     "char",   "const",    "continue",
+    "default",  "do",       "double",   "else",   "enum",     "extern",
+    "float",    "for",      "goto",     "if",     "inline",   "int",
+    "long",     "register", "restrict", "return", "short",    "signed",
+    "sizeof",   "static",   "struct",   "switch", "typedef",  "union",
+    "unsigned", "void",     "volatile", "while",  "_Bool",    "NULL"};
+
+std::string ElementMemo::fingerprint(const std::string &kind,
+                                     const std::string &function,
+                                     unsigned offset,
+                                     const std::string &text) {
+  // FNV-1a over the text with every whitespace run folded into one space
+  unsigned long long hash = 14695981039346656037ULL;
+  bool space = false;
+  for (auto const &chr : text) {
+    if (isspace(chr)) {
+      space = true;
+      continue;
+    }
+    if (space) {
+      hash = (hash ^ ' ') * 1099511628211ULL;
+      space = false;
+    }
+    hash = (hash ^ static_cast<unsigned char>(chr)) * 1099511628211ULL;
+  }
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", hash);
+  return kind + ":" + function + ":" + std::to_string(offset) + ":" + hex;
+}
+
+std::vector<std::string> ElementMemo::getIdentifiers(const std::string &text) {
+  std::set<std::string> ids;
+  for (size_t i = 0; i < text.size();) {
+    if (isalpha(text[i]) || text[i] == '_') {
+      size_t j = i + 1;
+      while (j < text.size() && (isalnum(text[j]) || text[j] == '_'))
+        j++;
+      std::string id = text.substr(i, j - i);
+      if (keywords.find(id) == keywords.end())
+        ids.insert(id);
+      i = j;
+    } else if (isdigit(text[i])) {
+      while (i < text.size() && (isalnum(text[i]) || text[i] == '_'))
+        i++;
+    } else {
+      i++;
+    }
+  }
+  return std::vector<std::string>(ids.begin(), ids.end());
+}
+
+// a removal that touched one of its identifiers may have made it removable
+bool ElementMemo::isStale(const Entry &entry) {
+  for (auto const &dep : entry.deps) {
+    auto removed = lastRemoved.find(dep);
+    if (removed != lastRemoved.end() && removed->second > entry.epoch)
+      return true;
+  }
+  return false;
+}
+
+bool ElementMemo::isEssential(const std::string &fp) {
+  auto entry = essentials.find(fp);
+  if (entry == essentials.end())
+    return false;
+  if (isStale(entry->second)) {
+    essentials.erase(entry);
+    return false;
+  }
+  Report::memoHitsCounter.increment();
+  return true;
+}
+
+bool ElementMemo::isKnownEssential(const std::string &fp) {
+  auto entry = essentials.find(fp);
+  return entry != essentials.end() && !isStale(entry->second);
+}
+
+void ElementMemo::markEssential(const std::string &fp,
+                                const std::string &text) {
+  Entry entry;
+  entry.epoch = epoch;
+  entry.deps = getIdentifiers(text);
+  essentials[fp] = entry;
+}
+
+void ElementMemo::markRemoved(const std::string &text) {
+  epoch++;
+  for (auto const &id : getIdentifiers(text))
+    lastRemoved[id] = epoch;
+}
+
+void ElementMemo::clear(void) {
+  essentials.clear();
+  lastRemoved.clear();
+}
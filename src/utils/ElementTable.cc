@@ -0,0 +1,39 @@
+#include "ElementTable.h"
+
+#include <algorithm>
+
+unsigned ElementTable::add(const std::string &Kind, unsigned Begin,
+                           unsigned End, int Parent, unsigned Deps) {
+  Kinds.emplace_back(Kind);
+  Begins.emplace_back(Begin);
+  Ends.emplace_back(End);
+  Sizes.emplace_back(End - Begin);
+  Parents.emplace_back(Parent);
+  Dependencies.emplace_back(Deps);
+  return Begins.size() - 1;
+}
+
+void ElementTable::clear(void) {
+  Kinds.clear();
+  Begins.clear();
+  Ends.clear();
+  Sizes.clear();
+  Parents.clear();
+  Dependencies.clear();
+}
+
+std::vector<ElementTable::Range>
+ElementTable::getRanges(const std::vector<unsigned> &Ids) const {
+  std::vector<Range> Ranges;
+  for (auto Id : Ids)
+    Ranges.emplace_back(getRange(Id));
+  std::sort(Ranges.begin(), Ranges.end());
+  std::vector<Range> Merged;
+  for (auto const &R : Ranges) {
+    if (!Merged.empty() && R.first <= Merged.back().second)
+      Merged.back().second = std::max(Merged.back().second, R.second);
+    else
+      Merged.emplace_back(R);
+  }
+  return Merged;
+}
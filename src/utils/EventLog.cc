@@ -0,0 +1,97 @@
+#include "EventLog.h"
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+int EventLog::fd = -1;
+
+static const size_t FlushSize = 1 << 16;
+
+namespace {
+struct Sink {
+  std::string data;
+  // threads other than the main one flush when they end
+  ~Sink() { EventLog::flush(); }
+};
+
+thread_local Sink sink;
+} // namespace
+
+bool EventLog::open(const std::string &file) {
+  fd = ::open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0)
+    return false;
+  sink.data = "time,phase,kind,node,removed_bytes,candidate_bytes,"
+              "candidate_hash,verdict,wall_seconds,cpu_seconds,exit_code\n";
+  flush();
+  return true;
+}
+
+void EventLog::record(const Record &r) {
+  if (fd < 0)
+    return;
+  double time = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count() /
+                1e6;
+  char line[512];
+  int n = snprintf(line, sizeof(line),
+                   "%.6f,%s,%s,%s,%lu,%lu,%016llx,%s,%.6f,%.6f,%d\n", time,
+                   r.phase.c_str(), r.kind.c_str(), r.node.c_str(), r.removed,
+                   r.size, r.hash, r.verdict ? "pass" : "fail", r.wall, r.cpu,
+                   r.exitCode);
+  if (n <= 0)
+    return;
+  sink.data.append(line, std::min<size_t>(n, sizeof(line) - 1));
+  if (sink.data.size() >= FlushSize)
+    flush();
+}
+
+void EventLog::flush() {
+  if (fd < 0) {
+    sink.data.clear();
+    return;
+  }
+  const char *data = sink.data.data();
+  size_t left = sink.data.size();
+  while (left > 0) {
+    ssize_t written = write(fd, data, left);
+    if (written <= 0)
+      break;
+    data += written;
+    left -= written;
+  }
+  sink.data.clear();
+}
+
+void EventLog::close() {
+  if (fd < 0)
+    return;
+  flush();
+  ::close(fd);
+  fd = -1;
+}
+
+double EventLog::getChildrenCPUTime() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_CHILDREN, &usage) != 0)
+    return 0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int EventLog::getExitCode(int status) {
+  if (status == -1)
+    return -1;
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status);
+  if (WIFSIGNALED(status))
+    return 128 + WTERMSIG(status);
+  return -1;
+}
@@ -0,0 +1,49 @@
+#include "Memory.h"
+
+#include <cstdio>
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+long long Memory::limit = 0;
+
+void Memory::setLimit(int megabytes) {
+  limit = megabytes > 0 ? megabytes * 1024LL * 1024LL : 0;
+}
+
+bool Memory::isLimited() { return limit > 0; }
+
+bool Memory::exceeded() {
+  if (!isLimited())
+    return false;
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+  return getCurrentRSS() > limit;
+}
+
+long long Memory::getCurrentRSS() {
+  long long pages = 0;
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (statm) {
+    if (fscanf(statm, "%*s %lld", &pages) != 1)
+      pages = 0;
+    fclose(statm);
+  }
+  if (pages == 0)
+    return getPeakRSS();
+  return pages * sysconf(_SC_PAGESIZE);
+}
+
+long long Memory::getPeakRSS() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+#ifdef __APPLE__
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024LL;
+#endif
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstring>
 #include <getopt.h>
 #include <iostream>
@@ -5,6 +6,7 @@
 #include <unistd.h>
 
 #include "Options.h"
+#include "Oracle.h"
 
 const std::string usage_simple("Usage: chisel [OPTIONS]... ORACLE PROGRAM");
 const std::string error_message("Try 'chisel --help' for more information.");
@@ -15,7 +17,20 @@ void Option::showUsage() {
             << "  --help                 Show this help message" << std::endl
             << "  --output OUTPUT        De-bloated C file" << std::endl
             << "  --output_dir OUTDIR    Output directory" << std::endl
-            << "  --save_temp            Save intermediate results" << std::endl
+            << "  --save_temp            Save intermediate results to "
+               "OUTDIR/chisel-temp.archive (see chisel-extract)"
+            << std::endl
+            << "  --jobs N               Run up to N oracles in parallel"
+            << std::endl
+            << "  --copy_sandbox         Give every parallel oracle private "
+               "copies of the files in the current directory instead of links"
+            << std::endl
+            << "  --time_budget SECONDS  Stop after SECONDS, keeping the best "
+               "result so far in OUTPUT"
+            << std::endl
+            << "  --max_rss MB           Fall back to cheaper modes once the "
+               "resident set exceeds MB"
+            << std::endl
             << "  --no_d_tree            Disable decision tree learning"
             << std::endl
             << "  --no_delay_learning    Learn a new model for every iteration"
@@ -24,8 +39,19 @@ void Option::showUsage() {
             << std::endl
             << "  --skip_local           Skip function-level reduction"
             << std::endl
+            << "  --token                Finish with a token-level reduction"
+            << std::endl
+            << "  --line_prepass         Remove balanced chunks of lines before "
+               "parsing"
+            << std::endl
+            << "  --coverage             Remove code the oracle never executes "
+               "first (runs the oracle with COV=1)"
+            << std::endl
             << "  --no_cache             Do not cache intermediate results"
             << std::endl
+            << "  --memo                 Remember elements whose removal "
+               "failed and skip them in later iterations (approximate)"
+            << std::endl
             << "  --no_local_dep         Disable local dependency checking"
             << std::endl
             << "  --no_global_dep        Disable global dependency checking"
@@ -35,8 +61,25 @@ void Option::showUsage() {
             << std::endl
             << "  --no_profile           Do not print profiling report"
             << std::endl
+            << "  --event_log FILE       Append one CSV record per oracle call "
+               "to FILE"
+            << std::endl
+            << "  --report_json FILE     Write the run report as JSON"
+            << std::endl
+            << "  --status FILE          Keep FILE updated with the live "
+               "progress of the run"
+            << std::endl
+            << "  --trace FILE           Write where the time went as a Chrome "
+               "trace (chrome://tracing)"
+            << std::endl
             << "  --verbose              Print output information" << std::endl
             << "  --stat                 Count the number of statements"
+            << std::endl
+            << "ORACLE is a script, or an in-process check builtin:SPEC with "
+               "SPEC one or more of"
+            << std::endl
+            << "  parses, symbols=A,B,..., random=P[,SEED] and pattern=REGEX "
+               "(last), joined by +"
             << std::endl;
 }
 
@@ -45,35 +88,59 @@ static struct option long_options[] = {
     {"output", required_argument, 0, 'o'},
     {"output_dir", required_argument, 0, 't'},
     {"save_temp", no_argument, 0, 's'},
+    {"jobs", required_argument, 0, 'j'},
+    {"copy_sandbox", no_argument, 0, 'y'},
+    {"time_budget", required_argument, 0, 'T'},
+    {"max_rss", required_argument, 0, 'R'},
     {"no_d_tree", no_argument, 0, 'D'},
     {"no_delay_learning", no_argument, 0, 'd'},
     {"skip_global", no_argument, 0, 'g'},
     {"skip_local", no_argument, 0, 'l'},
+    {"token", no_argument, 0, 'k'},
+    {"line_prepass", no_argument, 0, 'P'},
+    {"coverage", no_argument, 0, 'V'},
     {"no_cache", no_argument, 0, 'c'},
+    {"memo", no_argument, 0, 'M'},
     {"no_local_dep", no_argument, 0, 'L'},
     {"no_global_dep", no_argument, 0, 'G'},
     {"skip_dce", no_argument, 0, 'C'},
     {"no_profile", no_argument, 0, 'p'},
+    {"event_log", required_argument, 0, 'E'},
+    {"report_json", required_argument, 0, 'J'},
+    {"status", required_argument, 0, 'Z'},
+    {"trace", required_argument, 0, 'x'},
     {"verbose", no_argument, 0, 'v'},
     {"stat", no_argument, 0, 'S'},
     {0, 0, 0, 0}};
 
-static const char *optstring = "ho:t:sDdglcLGCpvS";
+static const char *optstring = "ho:t:sj:yT:R:DdglkPVcMLGCpE:J:Z:x:vS";
 
 std::string Option::inputFile = "";
 std::string Option::outputFile = "";
 std::string Option::oracleFile = "";
 std::string Option::outputDir = "chisel-out";
 bool Option::saveTemp = false;
+int Option::jobs = 1;
+bool Option::copySandbox = false;
+int Option::timeBudget = 0;
+int Option::maxRSS = 0;
 bool Option::decisionTree = true;
 bool Option::delayLearning = true;
 bool Option::skipGlobal = false;
 bool Option::skipLocal = false;
+bool Option::tokenReduction = false;
+bool Option::coverage = false;
+bool Option::linePrepass = false;
 bool Option::noCache = true;
+bool Option::memoize = false;
 bool Option::globalDep = true;
 bool Option::localDep = true;
 bool Option::skipDCE = false;
 bool Option::profile = true;
+std::string Option::eventLog = "";
+std::string Option::reportJson = "";
+std::string Option::statusFile = "";
+std::string Option::traceFile = "";
 bool Option::verbose = false;
 bool Option::stat = false;
 
@@ -97,6 +164,22 @@ void Option::handleOptions(int argc, char *argv[]) {
       Option::saveTemp = true;
       break;
 
+    case 'j':
+      Option::jobs = std::max(1, atoi(optarg));
+      break;
+
+    case 'y':
+      Option::copySandbox = true;
+      break;
+
+    case 'T':
+      Option::timeBudget = std::max(0, atoi(optarg));
+      break;
+
+    case 'R':
+      Option::maxRSS = std::max(0, atoi(optarg));
+      break;
+
     case 'D':
       Option::decisionTree = false;
       break;
@@ -113,10 +196,26 @@ void Option::handleOptions(int argc, char *argv[]) {
       Option::skipLocal = true;
       break;
 
+    case 'k':
+      Option::tokenReduction = true;
+      break;
+
+    case 'P':
+      Option::linePrepass = true;
+      break;
+
+    case 'V':
+      Option::coverage = true;
+      break;
+
     case 'c':
       Option::noCache = true;
       break;
 
+    case 'M':
+      Option::memoize = true;
+      break;
+
     case 'L':
       Option::localDep = false;
       break;
@@ -133,6 +232,22 @@ void Option::handleOptions(int argc, char *argv[]) {
       Option::profile = false;
       break;
 
+    case 'E':
+      Option::eventLog = std::string(optarg);
+      break;
+
+    case 'J':
+      Option::reportJson = std::string(optarg);
+      break;
+
+    case 'Z':
+      Option::statusFile = std::string(optarg);
+      break;
+
+    case 'x':
+      Option::traceFile = std::string(optarg);
+      break;
+
     case 'v':
       Option::verbose = true;
       break;
@@ -163,7 +278,8 @@ void Option::handleOptions(int argc, char *argv[]) {
     Option::oracleFile = std::string(argv[optind]);
     Option::inputFile = std::string(argv[optind + 1]);
 
-    if (access(Option::oracleFile.c_str(), F_OK) == -1) {
+    if (!Oracle::isBuiltin(Option::oracleFile) &&
+        access(Option::oracleFile.c_str(), F_OK) == -1) {
       std::cerr << "The specified oracle file " << Option::oracleFile
                 << " does not exist." << std::endl;
       exit(1);
@@ -1,6 +1,10 @@
-#include <sys/time.h>
+#include <unistd.h>
 
-#include <ctime>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "Profiling.h"
 
@@ -10,22 +14,117 @@ Profiler::Profiler() {
   elapsed = 0;
 }
 
-void Profiler::startTimer() { begin = getTimeMs(); }
+void Profiler::startTimer() { begin = Trace::now(); }
 
 void Profiler::stopTimer() {
-  end = getTimeMs();
+  end = Trace::now();
   elapsed += end - begin;
 }
 
 double Profiler::getElapsedTime() { // seconds
-  return elapsed / 1000.0;
+  return elapsed / 1e9;
 }
 
-__int128_t Profiler::getTimeMs() {
-  struct timeval tv;
-  gettimeofday(&tv, NULL);
-  __int128_t ret = tv.tv_usec;
-  ret /= 1000;
-  ret += (tv.tv_sec * 1000);
-  return ret;
+bool Trace::enabled = false;
+long long Trace::origin = 0;
+
+namespace {
+struct Event {
+  std::string name;
+  const char *category;
+  std::string detail;
+  long long begin;
+  long long end;
+};
+
+struct Buffer {
+  int tid;
+  std::vector<Event> events;
+};
+
+// buffers outlive their threads so that write sees every span
+std::mutex buffersLock;
+std::vector<std::unique_ptr<Buffer>> buffers;
+
+Buffer &getBuffer() {
+  thread_local Buffer *buffer = NULL;
+  if (!buffer) {
+    std::lock_guard<std::mutex> lock(buffersLock);
+    buffers.emplace_back(new Buffer());
+    buffer = buffers.back().get();
+    buffer->tid = buffers.size();
+  }
+  return *buffer;
+}
+
+std::string escape(const std::string &str) {
+  std::string result;
+  for (auto const &chr : str) {
+    if (chr == '"' || chr == '\\')
+      result += '\\';
+    if (static_cast<unsigned char>(chr) >= 0x20)
+      result += chr;
+  }
+  return result;
+}
+} // namespace
+
+void Trace::enable() {
+  enabled = true;
+  origin = now();
+}
+
+long long Trace::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Trace::complete(const std::string &name, const char *category,
+                     long long begin, const std::string &detail) {
+  if (!enabled)
+    return;
+  Event event = {name, category, detail, begin, now()};
+  getBuffer().events.emplace_back(std::move(event));
+}
+
+bool Trace::write(const std::string &file) {
+  std::ofstream out(file);
+  if (!out)
+    return false;
+  std::lock_guard<std::mutex> lock(buffersLock);
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  out.precision(3);
+  out << std::fixed;
+  for (auto const &buffer : buffers) {
+    for (auto const &event : buffer->events) {
+      out << (first ? "\n" : ",\n") << "{\"name\":\"" << escape(event.name)
+          << "\",\"cat\":\"" << event.category
+          << "\",\"ph\":\"X\",\"ts\":" << (event.begin - origin) / 1000.0
+          << ",\"dur\":" << (event.end - event.begin) / 1000.0
+          << ",\"pid\":" << getpid() << ",\"tid\":" << buffer->tid;
+      if (!event.detail.empty())
+        out << ",\"args\":{\"detail\":\"" << escape(event.detail) << "\"}";
+      out << "}";
+      first = false;
+    }
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  return static_cast<bool>(out);
+}
+
+Span::Span(const std::string &name, const char *category,
+           const std::string &detail)
+    : category(category), begin(0) {
+  if (!Trace::isEnabled())
+    return;
+  this->name = name;
+  this->detail = detail;
+  begin = Trace::now();
+}
+
+Span::~Span() {
+  if (begin != 0)
+    Trace::complete(name, category, begin, detail);
 }
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <fstream>
+#include <sys/resource.h>
+
 #include "Report.h"
 #include "Counting.h"
+#include "Memory.h"
 #include "Options.h"
 #include "Profiling.h"
 #include "Stats.h"
@@ -7,19 +12,70 @@
 Profiler Report::totalProfiler;
 Profiler Report::learningProfiler;
 Profiler Report::oracleProfiler;
+Profiler Report::parseProfiler;
 Counter Report::globalCallsCounter;
 Counter Report::localCallsCounter;
 Counter Report::successfulGlobalCallsCounter;
 Counter Report::successfulLocalCallsCounter;
+Counter Report::tokenCallsCounter;
+Counter Report::successfulTokenCallsCounter;
+Counter Report::lineCallsCounter;
+Counter Report::successfulLineCallsCounter;
+Counter Report::memoHitsCounter;
+std::map<std::string, Counter> Report::callsByKind;
+std::map<std::string, Counter> Report::successfulCallsByKind;
+std::map<std::string, Profiler> Report::oracleProfilerByKind;
+std::vector<double> Report::oracleTimes;
+Stats::Sizes Report::originalSizes;
+Stats::Sizes Report::finalSizes;
+
+void Report::reset() {
+  totalProfiler = learningProfiler = oracleProfiler = parseProfiler =
+      Profiler();
+  for (Counter *counter :
+       {&globalCallsCounter, &localCallsCounter, &successfulGlobalCallsCounter,
+        &successfulLocalCallsCounter, &tokenCallsCounter,
+        &successfulTokenCallsCounter, &lineCallsCounter,
+        &successfulLineCallsCounter, &memoHitsCounter})
+    *counter = Counter();
+  callsByKind.clear();
+  successfulCallsByKind.clear();
+  oracleProfilerByKind.clear();
+  oracleTimes.clear();
+  originalSizes = finalSizes = Stats::Sizes();
+}
+
+double Report::getSuccessRate(const std::string &kind) {
+  // Laplace-smoothed, so unseen kinds start at 1/2
+  unsigned calls = callsByKind[kind].count();
+  unsigned successes = successfulCallsByKind[kind].count();
+  return (successes + 1.0) / (calls + 2.0);
+}
+
+double Report::getMeanOracleTime(const std::string &kind) {
+  unsigned calls = callsByKind[kind].count();
+  double time = oracleProfilerByKind[kind].getElapsedTime();
+  if (calls == 0) {
+    for (auto &entry : callsByKind)
+      calls += entry.second.count();
+    time = oracleProfiler.getElapsedTime();
+  }
+  if (calls == 0)
+    return 1.0;
+  return std::max(time / calls, 0.001);
+}
 
 void Report::print() {
   std::cout << "========================================\n";
   std::cout << "                 Report                 \n";
   std::cout << "========================================\n";
-  //auto stmt = Stats::getStatementCount(Option::inputFile.c_str());
-  std::cout << "Original Size: " << /*stmt[0]*/0 << " statements" << std::endl;
-  //stmt = Stats::getStatementCount(Option::outputFile.c_str());
-  std::cout << "Reduced Size: " << /*stmt[0]*/0 << " statements" << std::endl;
+  std::cout << "Original Size: " << originalSizes.statements << " statements, "
+            << originalSizes.bytes << " bytes" << std::endl;
+  std::cout << "Reduced Size: " << finalSizes.statements << " statements, "
+            << finalSizes.bytes << " bytes" << std::endl;
+  if (Option::linePrepass)
+    std::cout << "Line Success Ratio: " << successfulLineCallsCounter.count()
+              << "/" << lineCallsCounter.count() << std::endl;
   if (!Option::skipGlobal)
     std::cout << "Global Success Ratio: "
               << successfulGlobalCallsCounter.count() << "/"
@@ -27,11 +83,129 @@ void Report::print() {
   if (!Option::skipLocal)
     std::cout << "Local Success Ratio: " << successfulLocalCallsCounter.count()
               << "/" << localCallsCounter.count() << std::endl;
+  if (Option::tokenReduction)
+    std::cout << "Token Success Ratio: " << successfulTokenCallsCounter.count()
+              << "/" << tokenCallsCounter.count() << std::endl;
+  if (Option::memoize)
+    std::cout << "Memo Hits: " << memoHitsCounter.count() << std::endl;
   if (Option::decisionTree)
     std::cout << "Learning Time: " << learningProfiler.getElapsedTime() << " s"
               << std::endl;
+  if (Option::timeBudget > 0)
+    std::cout << "Time Budget: " << Option::timeBudget << " s" << std::endl;
   std::cout << "Oracle Time: " << oracleProfiler.getElapsedTime() << " s"
             << std::endl;
   std::cout << "Total Time: " << totalProfiler.getElapsedTime() << " s"
             << std::endl;
+  std::cout << "Peak RSS: " << Memory::getPeakRSS() / (1024 * 1024) << " MB"
+            << std::endl;
+}
+
+static void writeSizes(std::ofstream &out, const Stats::Sizes &sizes) {
+  out << "{\"bytes\": " << sizes.bytes << ", \"tokens\": " << sizes.tokens
+      << ", \"statements\": " << sizes.statements
+      << ", \"functions\": " << sizes.functions << "}";
+}
+
+// leaves the object open for more fields
+static void writeCalls(std::ofstream &out, unsigned calls, unsigned successes) {
+  out << "{\"calls\": " << calls << ", \"successes\": " << successes
+      << ", \"success_rate\": "
+      << (calls == 0 ? 0.0 : static_cast<double>(successes) / calls);
+}
+
+// nearest rank on sorted times
+static double getPercentile(const std::vector<double> &times, double p) {
+  if (times.empty())
+    return 0;
+  unsigned rank = static_cast<unsigned>(p * times.size() + 0.999999);
+  return times[std::min<unsigned>(std::max(rank, 1u), times.size()) - 1];
+}
+
+static double getCPUTime(int who) {
+  struct rusage usage;
+  if (getrusage(who, &usage) != 0)
+    return 0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+bool Report::writeJson(const std::string &file) {
+  std::ofstream out(file);
+  if (!out)
+    return false;
+  double total = totalProfiler.getElapsedTime();
+  unsigned calls = 0;
+  for (auto &entry : callsByKind)
+    calls += entry.second.count();
+  std::vector<double> times = oracleTimes;
+  std::sort(times.begin(), times.end());
+  double mean = 0;
+  for (auto const &time : times)
+    mean += time;
+  if (!times.empty())
+    mean /= times.size();
+
+  out << "{\n";
+  out << "  \"original\": ";
+  writeSizes(out, originalSizes);
+  out << ",\n  \"final\": ";
+  writeSizes(out, finalSizes);
+
+  std::map<std::string, std::pair<unsigned, unsigned>> phases;
+  phases["line"] = {lineCallsCounter.count(),
+                    successfulLineCallsCounter.count()};
+  phases["coverage"] = {callsByKind["coverage"].count(),
+                        successfulCallsByKind["coverage"].count()};
+  phases["global"] = {globalCallsCounter.count(),
+                      successfulGlobalCallsCounter.count()};
+  phases["local"] = {localCallsCounter.count(),
+                     successfulLocalCallsCounter.count()};
+  phases["token"] = {tokenCallsCounter.count(),
+                     successfulTokenCallsCounter.count()};
+  out << ",\n  \"phases\": {";
+  bool first = true;
+  for (auto const &phase : phases) {
+    out << (first ? "\n" : ",\n") << "    \"" << phase.first << "\": ";
+    writeCalls(out, phase.second.first, phase.second.second);
+    out << "}";
+    first = false;
+  }
+  out << "\n  },\n  \"kinds\": {";
+  first = true;
+  for (auto &entry : callsByKind) {
+    out << (first ? "\n" : ",\n") << "    \"" << entry.first << "\": ";
+    writeCalls(out, entry.second.count(),
+               successfulCallsByKind[entry.first].count());
+    out << ", \"oracle_time\": "
+        << oracleProfilerByKind[entry.first].getElapsedTime() << "}";
+    first = false;
+  }
+  out << "\n  },\n";
+
+  out << "  \"oracle_calls\": " << calls << ",\n";
+  out << "  \"memo_hits\": " << memoHitsCounter.count() << ",\n";
+  out << "  \"time\": {\"total\": " << total
+      << ", \"parse\": " << parseProfiler.getElapsedTime()
+      << ", \"oracle\": " << oracleProfiler.getElapsedTime()
+      << ", \"learning\": " << learningProfiler.getElapsedTime()
+      << ", \"budget\": " << Option::timeBudget << "},\n";
+  out << "  \"oracle_time\": {\"mean\": " << mean
+      << ", \"p50\": " << getPercentile(times, 0.5)
+      << ", \"p90\": " << getPercentile(times, 0.9)
+      << ", \"p99\": " << getPercentile(times, 0.99)
+      << ", \"max\": " << (times.empty() ? 0.0 : times.back()) << "},\n";
+  double removed = static_cast<double>(originalSizes.bytes) -
+                   static_cast<double>(finalSizes.bytes);
+  out << "  \"throughput\": {\"oracle_calls_per_second\": "
+      << (total > 0 ? calls / total : 0.0)
+      << ", \"bytes_removed_per_second\": "
+      << (total > 0 ? removed / total : 0.0) << "},\n";
+  // the oracles and forked workers run as children
+  out << "  \"cpu\": {\"chisel\": " << getCPUTime(RUSAGE_SELF)
+      << ", \"children\": " << getCPUTime(RUSAGE_CHILDREN) << "},\n";
+  out << "  \"jobs\": " << Option::jobs << ",\n";
+  out << "  \"peak_rss\": " << Memory::getPeakRSS() << "\n";
+  out << "}\n";
+  return static_cast<bool>(out);
 }
@@ -27,6 +27,7 @@ RewriteUtils *RewriteUtils::GetInstance(Rewriter *RW) {
   if (RewriteUtils::Instance) {
     RewriteUtils::Instance->TheRewriter = RW;
     RewriteUtils::Instance->SrcManager = &(RW->getSourceMgr());
+    RewriteUtils::Instance->Delimiters.clear();
     return RewriteUtils::Instance;
   }
 
@@ -86,7 +87,24 @@ SourceLocation RewriteUtils::getEndLocationFromBegin(SourceRange Range) {
   return StartLoc.getLocWithOffset(LocRangeSize);
 }
 
+const DelimiterIndex &RewriteUtils::getDelimiterIndex(void) {
+  if (!Delimiters.isBuilt()) {
+    StringRef Data = SrcManager->getBufferData(SrcManager->getMainFileID());
+    Delimiters.build(Data.begin(), Data.end());
+  }
+  return Delimiters;
+}
+
 int RewriteUtils::getOffsetUntil(const char *Buf, char Symbol) {
+  if (DelimiterIndex::isIndexed(Symbol)) {
+    const DelimiterIndex &Index = getDelimiterIndex();
+    if (Index.contains(Buf)) {
+      int Offset = Index.findNext(Buf, Symbol);
+      if (Offset >= 0)
+        return Offset;
+    }
+  }
+
   int Offset = 0;
   while (*Buf != Symbol) {
     Buf++;
@@ -1557,19 +1575,22 @@ bool RewriteUtils::removeVarDecl(const VarDecl *VD) {
 bool RewriteUtils::removeTextFromLeftAt(SourceRange Range, char C,
                                         SourceLocation EndLoc) {
   SourceLocation StartLoc = Range.getBegin();
-  const char *StartBuf = SrcManager->getCharacterData(StartLoc);
-  int Offset = 0;
-  while (*StartBuf != C) {
-    StartBuf--;
-    Offset--;
-  }
-  StartLoc = StartLoc.getLocWithOffset(Offset);
+  StartLoc = getLocationFromLeftUntil(StartLoc, C);
   return !TheRewriter->RemoveText(SourceRange(StartLoc, EndLoc));
 }
 
 SourceLocation RewriteUtils::getLocationFromLeftUntil(SourceLocation StartLoc,
                                                       char C) {
   const char *StartBuf = SrcManager->getCharacterData(StartLoc);
+  if (DelimiterIndex::isIndexed(C)) {
+    const DelimiterIndex &Index = getDelimiterIndex();
+    if (Index.contains(StartBuf)) {
+      int Offset = Index.findPrevious(StartBuf, C);
+      if (Offset <= 0)
+        return StartLoc.getLocWithOffset(Offset);
+    }
+  }
+
   int Offset = 0;
   while (*StartBuf != C) {
     StartBuf--;
@@ -0,0 +1,108 @@
+#include "Sandbox.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Options.h"
+
+static std::string getAbsolutePath(const std::string &path) {
+  char buf[PATH_MAX];
+  if (realpath(path.c_str(), buf) == NULL)
+    return "";
+  return buf;
+}
+
+bool Sandbox::isSupported() {
+  // the oracle finds the input by its relative path
+  return !Option::inputFile.empty() && Option::inputFile[0] != '/' &&
+         Option::inputFile.find("..") == std::string::npos;
+}
+
+// under --copy_sandbox, a private copy, so that scratch files the oracle
+// writes next to the input are not shared between sandboxes
+static bool copyFile(const std::string &from, const std::string &to,
+                     mode_t mode) {
+  int in = open(from.c_str(), O_RDONLY);
+  if (in < 0)
+    return false;
+  int out = open(to.c_str(), O_WRONLY | O_CREAT | O_EXCL, mode & ACCESSPERMS);
+  bool ok = out >= 0;
+  char buf[1 << 16];
+  ssize_t n = 0;
+  while (ok && (n = read(in, buf, sizeof(buf))) > 0)
+    ok = write(out, buf, n) == n;
+  ok &= n == 0;
+  if (out >= 0)
+    ok &= close(out) == 0;
+  close(in);
+  return ok;
+}
+
+bool Sandbox::mirror(const std::string &from, const std::string &to,
+                     const std::string &path) {
+  size_t slash = path.find('/');
+  std::string head = path.substr(0, slash);
+  if (head == "." && slash != std::string::npos)
+    return mirror(from, to, path.substr(slash + 1));
+  DIR *dir = opendir(from.c_str());
+  if (dir == NULL)
+    return false;
+  bool ok = true;
+  while (struct dirent *entry = readdir(dir)) {
+    std::string name = entry->d_name;
+    if (name == "." || name == ".." || name == head)
+      continue;
+    std::string source = from + "/" + name, target = to + "/" + name;
+    struct stat st;
+    if (Option::copySandbox && lstat(source.c_str(), &st) == 0 &&
+        S_ISREG(st.st_mode))
+      ok &= copyFile(source, target, st.st_mode);
+    else
+      ok &= symlink(source.c_str(), target.c_str()) == 0;
+  }
+  closedir(dir);
+  if (slash == std::string::npos)
+    return ok;
+
+  std::string sub = "/" + head;
+  if (mkdir((to + sub).c_str(), ACCESSPERMS) != 0)
+    return false;
+  return ok && mirror(from + sub, to + sub, path.substr(slash + 1));
+}
+
+std::string Sandbox::getPath(int id) {
+  std::string outputDir = getAbsolutePath(Option::outputDir);
+  if (outputDir.empty())
+    return "";
+  return outputDir + "/sandbox-" + std::to_string(getpid()) + "-" +
+         std::to_string(id);
+}
+
+bool Sandbox::create(const std::string &dir) {
+  std::string cwd = getAbsolutePath(".");
+  if (dir.empty() || cwd.empty())
+    return false;
+  remove(dir);
+  if (mkdir(dir.c_str(), ACCESSPERMS) != 0)
+    return false;
+  if (!mirror(cwd, dir, Option::inputFile)) {
+    remove(dir);
+    return false;
+  }
+  return true;
+}
+
+static int removeEntry(const char *path, const struct stat *sb, int flag,
+                       struct FTW *ftw) {
+  return ::remove(path);
+}
+
+void Sandbox::remove(const std::string &dir) {
+  // FTW_PHYS so that symlinked entries are unlinked, never followed
+  nftw(dir.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
@@ -0,0 +1,196 @@
+#include "SourceVersion.h"
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+
+#include "StringUtils.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+SourceVersion::SourceVersion(const std::string &Original) : Blanked(0) {
+  auto B = std::make_shared<Buffers>();
+  B->Original = Original;
+  B->Blank = StringUtils::placeholder(Original);
+  Base = B;
+}
+
+SourceVersion::NodePtr SourceVersion::makeNode(unsigned Begin, unsigned End,
+                                               const NodePtr &Left,
+                                               const NodePtr &Right) {
+  // a hash of the key keeps the treap balanced and the runs reproducible
+  unsigned long long H = Begin * 0x9E3779B97F4A7C15ULL;
+  H ^= H >> 31;
+  return std::make_shared<const Node>(
+      Node{Begin, End, static_cast<unsigned>(H >> 32), Left, Right});
+}
+
+SourceVersion::NodePtr SourceVersion::merge(const NodePtr &L,
+                                            const NodePtr &R) {
+  if (!L)
+    return R;
+  if (!R)
+    return L;
+  if (L->Priority > R->Priority)
+    return makeNode(L->Begin, L->End, L->Left, merge(L->Right, R));
+  return makeNode(R->Begin, R->End, merge(L, R->Left), R->Right);
+}
+
+// L gets the ranges beginning before Key, R the others
+void SourceVersion::split(const NodePtr &T, unsigned Key, NodePtr &L,
+                          NodePtr &R) {
+  if (!T) {
+    L = R = nullptr;
+  } else if (T->Begin < Key) {
+    NodePtr Rest;
+    split(T->Right, Key, Rest, R);
+    L = makeNode(T->Begin, T->End, T->Left, Rest);
+  } else {
+    NodePtr Rest;
+    split(T->Left, Key, L, Rest);
+    R = makeNode(T->Begin, T->End, Rest, T->Right);
+  }
+}
+
+const SourceVersion::Node *SourceVersion::getMax(const NodePtr &T) {
+  const Node *N = T.get();
+  while (N && N->Right)
+    N = N->Right.get();
+  return N;
+}
+
+unsigned SourceVersion::getLength(const NodePtr &T) {
+  if (!T)
+    return 0;
+  return T->End - T->Begin + getLength(T->Left) + getLength(T->Right);
+}
+
+SourceVersion::NodePtr SourceVersion::removeMax(const NodePtr &T) {
+  if (!T->Right)
+    return T->Left;
+  return makeNode(T->Begin, T->End, T->Left, removeMax(T->Right));
+}
+
+SourceVersion SourceVersion::blank(Range R) const {
+  SourceVersion V = *this;
+  unsigned Begin = R.first, End = std::min<unsigned>(R.second, size());
+  if (Begin >= End)
+    return V;
+
+  // absorb the ranges that overlap or touch [Begin, End)
+  NodePtr L, Rest, M, Right;
+  split(Root, Begin, L, Rest);
+  const Node *Prev = getMax(L);
+  if (Prev && Prev->End >= Begin) {
+    Begin = Prev->Begin;
+    End = std::max(End, Prev->End);
+    V.Blanked -= Prev->End - Prev->Begin;
+    L = removeMax(L);
+  }
+  split(Rest, End + 1, M, Right);
+  if (const Node *Last = getMax(M))
+    End = std::max(End, Last->End);
+  V.Blanked += End - Begin - getLength(M);
+  V.Root = merge(merge(L, makeNode(Begin, End, nullptr, nullptr)), Right);
+  return V;
+}
+
+SourceVersion SourceVersion::blank(const std::vector<Range> &Ranges) const {
+  SourceVersion V = *this;
+  for (auto const &R : Ranges)
+    V = V.blank(R);
+  return V;
+}
+
+unsigned SourceVersion::size() const {
+  return Base ? Base->Original.size() : 0;
+}
+
+void SourceVersion::collect(const NodePtr &T, Range R,
+                            std::vector<Range> &Out) {
+  if (!T)
+    return;
+  if (T->Begin > R.first)
+    collect(T->Left, R, Out);
+  if (T->End > R.first && T->Begin < R.second)
+    Out.emplace_back(Range(T->Begin, T->End));
+  if (T->End < R.second)
+    collect(T->Right, R, Out);
+}
+
+std::vector<SourceVersion::Range> SourceVersion::getBlanks(Range R) const {
+  std::vector<Range> Out;
+  collect(Root, R, Out);
+  return Out;
+}
+
+template <typename F> void SourceVersion::forEachPiece(Range R, F Emit) const {
+  R.second = std::min<unsigned>(R.second, size());
+  unsigned Pos = R.first;
+  for (auto const &B : getBlanks(R)) {
+    unsigned Begin = std::max(B.first, R.first);
+    unsigned End = std::min(B.second, R.second);
+    if (Pos < Begin)
+      Emit(Base->Original.data() + Pos, Begin - Pos);
+    Emit(Base->Blank.data() + Begin, End - Begin);
+    Pos = End;
+  }
+  if (Pos < R.second)
+    Emit(Base->Original.data() + Pos, R.second - Pos);
+}
+
+std::string SourceVersion::getText(Range R) const {
+  std::string Text;
+  if (!Base)
+    return Text;
+  forEachPiece(R, [&Text](const char *Data, size_t Size) {
+    Text.append(Data, Size);
+  });
+  return Text;
+}
+
+std::string SourceVersion::str() const { return getText(Range(0, size())); }
+
+unsigned long long SourceVersion::hash() const {
+  unsigned long long H = StringUtils::hash(NULL, 0);
+  if (Base)
+    forEachPiece(Range(0, size()), [&H](const char *Data, size_t Size) {
+      H = StringUtils::hash(Data, Size, H);
+    });
+  return H;
+}
+
+bool SourceVersion::writeToFile(const std::string &Filename) const {
+  int FD = open(Filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (FD < 0)
+    return false;
+  std::vector<struct iovec> Pieces;
+  if (Base)
+    forEachPiece(Range(0, size()), [&Pieces](const char *Data, size_t Size) {
+      Pieces.push_back({const_cast<char *>(Data), Size});
+    });
+
+  bool OK = true;
+  size_t I = 0;
+  while (OK && I < Pieces.size()) {
+    int N = std::min<size_t>(Pieces.size() - I, IOV_MAX);
+    ssize_t Written = writev(FD, &Pieces[I], N);
+    if (Written < 0) {
+      OK = false;
+      break;
+    }
+    // skip what was written, resuming inside a piece on a short write
+    while (I < Pieces.size() && Written >= Pieces[I].iov_len)
+      Written -= Pieces[I++].iov_len;
+    if (Written > 0) {
+      Pieces[I].iov_base = static_cast<char *>(Pieces[I].iov_base) + Written;
+      Pieces[I].iov_len -= Written;
+    }
+  }
+  return close(FD) == 0 && OK;
+}
@@ -1,14 +1,72 @@
-#include <clang-c/Index.h>
 #include <string.h>
 
 #include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <string>
 
+#include "clang/AST/ASTConsumer.h"
+#include "clang/AST/ASTContext.h"
+#include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/SourceManager.h"
+#include "clang/Lex/Lexer.h"
+
 #include "Stats.h"
+#include "TransformationManager.h"
+
+using namespace clang;
+
+namespace {
+class SizeVisitor : public RecursiveASTVisitor<SizeVisitor> {
+public:
+  SizeVisitor(SourceManager &SM, Stats::Sizes &S) : SM(SM), S(S) {}
+
+  bool VisitFunctionDecl(FunctionDecl *FD) {
+    if (FD->isThisDeclarationADefinition() && isInMainFile(FD->getLocStart()))
+      S.functions++;
+    return true;
+  }
+
+  bool VisitCompoundStmt(CompoundStmt *CS) {
+    if (isInMainFile(CS->getLocStart()))
+      S.statements += CS->size();
+    return true;
+  }
+
+private:
+  bool isInMainFile(SourceLocation Loc) {
+    return SM.isInMainFile(SM.getExpansionLoc(Loc));
+  }
+  SourceManager &SM;
+  Stats::Sizes &S;
+};
+
+class SizeCounter : public ASTConsumer {
+public:
+  explicit SizeCounter(Stats::Sizes &S) : S(S) {}
+
+  void HandleTranslationUnit(ASTContext &Ctx) {
+    SourceManager &SM = Ctx.getSourceManager();
+    SizeVisitor(SM, S).TraverseDecl(Ctx.getTranslationUnitDecl());
+
+    FileID MainFileID = SM.getMainFileID();
+    StringRef Buffer = SM.getBufferData(MainFileID);
+    Lexer Lex(SM.getLocForStartOfFile(MainFileID), Ctx.getLangOpts(),
+              Buffer.begin(), Buffer.begin(), Buffer.end());
+    Token Tok;
+    for (Lex.LexFromRawLexer(Tok); Tok.isNot(tok::eof);
+         Lex.LexFromRawLexer(Tok))
+      S.tokens++;
+  }
+
+private:
+  Stats::Sizes &S;
+};
+} // namespace
 
 int Stats::getWordCount(const char *srcPath) {
   std::ifstream ifs(srcPath);
@@ -19,3 +77,23 @@ int Stats::getWordCount(const char *srcPath) {
   }
   return count;
 }
+
+unsigned long Stats::getByteCount(const std::string &source) {
+  unsigned long count = 0;
+  for (char c : source)
+    if (!isspace(static_cast<unsigned char>(c)))
+      count++;
+  return count;
+}
+
+Stats::Sizes Stats::getSizes(const char *srcPath) {
+  Sizes sizes;
+  std::ifstream ifs(srcPath, std::ios::binary);
+  std::stringstream buffer;
+  buffer << ifs.rdbuf();
+  std::string source = buffer.str();
+  sizes.bytes = getByteCount(source);
+  TransformationManager::parse(source, srcPath,
+                               llvm::make_unique<SizeCounter>(sizes));
+  return sizes;
+}
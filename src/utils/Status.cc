@@ -0,0 +1,144 @@
+#include "Status.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "Options.h"
+
+static std::atomic<int> iteration(0);
+static std::atomic<unsigned> elements(0);
+static std::atomic<unsigned> subsets(0);
+static std::atomic<unsigned> remaining(0);
+static std::atomic<unsigned> calls(0);
+static std::atomic<unsigned> successes(0);
+static std::atomic<unsigned long> size(0);
+static std::atomic<unsigned long> originalSize(0);
+
+// the phase changes a few times per run, so a lock is fine
+static std::mutex phaseLock;
+static std::string phase = "start";
+
+static std::string file;
+static std::thread writer;
+static std::mutex stopLock;
+static std::condition_variable stopped;
+static bool stopping = false;
+
+static std::chrono::steady_clock::time_point begin;
+static std::chrono::steady_clock::time_point lastTime;
+static unsigned lastCalls = 0;
+
+void Status::start(const std::string &statusFile) {
+  file = statusFile;
+  begin = lastTime = std::chrono::steady_clock::now();
+  write();
+  writer = std::thread([] {
+    std::unique_lock<std::mutex> lock(stopLock);
+    while (!stopped.wait_for(lock, std::chrono::seconds(1),
+                             [] { return stopping; }))
+      write();
+  });
+}
+
+void Status::stop() {
+  if (!writer.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(stopLock);
+    stopping = true;
+  }
+  stopped.notify_all();
+  writer.join();
+  setPhase("done");
+  remaining = 0;
+  write();
+}
+
+void Status::setPhase(const std::string &name) {
+  std::lock_guard<std::mutex> lock(phaseLock);
+  phase = name;
+}
+
+void Status::setIteration(int i) {
+  iteration.store(i, std::memory_order_relaxed);
+}
+
+void Status::startRound(unsigned e, unsigned s) {
+  elements.store(e, std::memory_order_relaxed);
+  subsets.store(s, std::memory_order_relaxed);
+  remaining.store(s, std::memory_order_relaxed);
+}
+
+void Status::nextCandidate() {
+  // workers may count concurrently; never go below zero
+  unsigned left = remaining.load(std::memory_order_relaxed);
+  while (left > 0 && !remaining.compare_exchange_weak(
+                         left, left - 1, std::memory_order_relaxed))
+    ;
+}
+
+void Status::countCalls(unsigned n, unsigned succeeded) {
+  calls.fetch_add(n, std::memory_order_relaxed);
+  successes.fetch_add(succeeded, std::memory_order_relaxed);
+}
+
+void Status::setSize(unsigned long bytes) {
+  unsigned long none = 0;
+  originalSize.compare_exchange_strong(none, bytes);
+  size.store(bytes, std::memory_order_relaxed);
+}
+
+void Status::write() {
+  if (file.empty())
+    return;
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - begin).count();
+  double window = std::chrono::duration<double>(now - lastTime).count();
+  unsigned total = calls.load(std::memory_order_relaxed);
+  double rate = elapsed > 0 ? total / elapsed : 0;
+  double recent = window > 0 ? (total - lastCalls) / window : 0;
+  lastTime = now;
+  lastCalls = total;
+  std::string current;
+  {
+    std::lock_guard<std::mutex> lock(phaseLock);
+    current = phase;
+  }
+
+  // what is left of the current ddmin round at the recent pace, capped by
+  // the time budget
+  unsigned left = remaining.load(std::memory_order_relaxed);
+  double pace = recent > 0 ? recent : rate;
+  double eta = pace > 0 ? left / pace : -1;
+  if (Option::timeBudget > 0) {
+    double budget = std::max(0.0, Option::timeBudget - elapsed);
+    eta = eta < 0 ? budget : std::min(eta, budget);
+  }
+
+  // written aside and renamed, so readers never see half a file
+  std::string temp = file + ".tmp";
+  {
+    std::ofstream out(temp);
+    out << "{\"phase\": \"" << current << "\""
+        << ", \"iteration\": " << iteration.load(std::memory_order_relaxed)
+        << ", \"round_elements\": " << elements.load(std::memory_order_relaxed)
+        << ", \"round_subsets\": " << subsets.load(std::memory_order_relaxed)
+        << ", \"remaining_candidates\": " << left
+        << ", \"oracle_calls\": " << total << ", \"successful_calls\": "
+        << successes.load(std::memory_order_relaxed)
+        << ", \"calls_per_second\": " << rate
+        << ", \"recent_calls_per_second\": " << recent
+        << ", \"original_bytes\": "
+        << originalSize.load(std::memory_order_relaxed)
+        << ", \"current_bytes\": " << size.load(std::memory_order_relaxed)
+        << ", \"elapsed_seconds\": " << elapsed
+        << ", \"eta_seconds\": " << eta << "}\n";
+  }
+  std::rename(temp.c_str(), file.c_str());
+}
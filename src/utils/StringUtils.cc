@@ -47,3 +47,10 @@ std::string StringUtils::placeholder(std::string str) {
   }
   return replacement;
 }
+
+unsigned long long StringUtils::hash(const char *data, size_t size,
+                                     unsigned long long seed) {
+  for (size_t i = 0; i < size; i++)
+    seed = (seed ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+  return seed;
+}
@@ -0,0 +1,130 @@
+#include "TempArchive.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include "StringUtils.h"
+
+const char *TempArchive::FileName = "chisel-temp.archive";
+
+int TempArchive::fd = -1;
+int TempArchive::bases = 0;
+
+static const char *Magic = "chisel-archive 2\n";
+
+static bool append(int fd, const std::string &record) {
+  const char *data = record.data();
+  size_t left = record.size();
+  while (left > 0) {
+    ssize_t written = write(fd, data, left);
+    if (written <= 0)
+      return false;
+    data += written;
+    left -= written;
+  }
+  return true;
+}
+
+bool TempArchive::open(const std::string &file) {
+  // absolute, so that workers in their sandboxes append to the same file
+  std::string path = file;
+  char cwd[PATH_MAX];
+  if (!path.empty() && path[0] != '/' && getcwd(cwd, sizeof(cwd)))
+    path = std::string(cwd) + "/" + path;
+  fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0)
+    return false;
+  bases = 0;
+  return append(fd, Magic);
+}
+
+void TempArchive::close() {
+  if (fd < 0)
+    return;
+  ::close(fd);
+  fd = -1;
+}
+
+int TempArchive::addBase(const std::string &text) {
+  if (fd < 0)
+    return -1;
+  int id = bases++;
+  std::string record =
+      "base " + std::to_string(id) + " " + std::to_string(text.size()) + "\n";
+  record += text;
+  record += "\n";
+  return append(fd, record) ? id : -1;
+}
+
+void TempArchive::addCandidate(int base, const std::string &name,
+                               const std::vector<Range> &blanks) {
+  if (fd < 0 || base < 0)
+    return;
+  std::ostringstream record;
+  record << "candidate " << base << " " << name.size() << "\n"
+         << name << "\n"
+         << blanks.size() << "\n";
+  for (auto const &blank : blanks)
+    record << blank.first << " " << blank.second << "\n";
+  append(fd, record.str());
+}
+
+bool TempArchive::read(const std::string &file,
+                       std::vector<std::string> &bases,
+                       std::vector<Candidate> &candidates) {
+  std::ifstream ifs(file, std::ios::binary);
+  std::string line;
+  if (!std::getline(ifs, line) || line + "\n" != Magic)
+    return false;
+  std::string kind;
+  while (ifs >> kind) {
+    if (kind == "base") {
+      int id;
+      size_t size;
+      if (!(ifs >> id >> size) || ifs.get() != '\n' ||
+          id != static_cast<int>(bases.size()))
+        return false;
+      std::string text(size, '\0');
+      if (!ifs.read(&text[0], size) || ifs.get() != '\n')
+        return false;
+      bases.emplace_back(std::move(text));
+    } else if (kind == "candidate") {
+      Candidate candidate;
+      size_t size, count;
+      if (!(ifs >> candidate.base >> size) || ifs.get() != '\n')
+        return false;
+      candidate.name.resize(size);
+      if ((size > 0 && !ifs.read(&candidate.name[0], size)) ||
+          ifs.get() != '\n' || !(ifs >> count))
+        return false;
+      for (size_t i = 0; i < count; i++) {
+        Range blank;
+        if (!(ifs >> blank.first >> blank.second))
+          return false;
+        candidate.blanks.emplace_back(blank);
+      }
+      candidates.emplace_back(std::move(candidate));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string TempArchive::rebuild(const std::string &base,
+                                 const std::vector<Range> &blanks) {
+  std::string text = base;
+  for (auto const &blank : blanks) {
+    if (blank.first >= blank.second || blank.second > text.size())
+      continue;
+    text.replace(blank.first, blank.second - blank.first,
+                 StringUtils::placeholder(text.substr(
+                     blank.first, blank.second - blank.first)));
+  }
+  return text;
+}